@@ -95,6 +95,9 @@
 	List of functions:
 		bcnrandom_inline, randCombined  - two methods called by kernels that actually perform generation steps
 
+		randCombined53 - the combined generator with 53 bits per call instead of 31 (the same seeds
+			and the same steps as randCombined)
+
 		Kernel_CountValues, Kernel_CountValues_Combined - example kernels that count the number
 			of generated values smaler than 0.9. They call their respective methods from the list above, and multiply
 			the returned values by 3^-33, then use the result
@@ -108,6 +111,17 @@
 
 		Kernel_Opt   - example kernel that writes generated values to an array in global memory 
 
+		Kernel_Opt_Multistep - same output as Kernel_Opt, the 8 values of each iteration are computed
+			from the same iterate by independent multiplications (more instructions in flight)
+
+		Kernel_Leapfrog - writes the sequence to global memory in its natural order, thread gid of T
+			generates the elements gid, gid+T, gid+2T, ... (seeds from Kernel_initGenerator with WorkPerThread = 1)
+
+		Kernel_Generate, Kernel_Count - the kernel family the examples above are instances of, templates of
+			the generator (step policy: bcn_step, multistep_step, combined_step<31|53>, constant_step), the
+			output type (or predicate of the count) and the unroll factor; the loop is run_stream of
+			bcnrand_kernel.h, shared with the host version, and WorkPerThread can be any value
+
 		TimeBarrettMethod - shows how to use the example kernels and times its execution, then prints the results
 			
 
@@ -151,6 +165,7 @@ using std::vector;
 #define ULL(x) APPEND(x, ull)
 
 #include "bcnrand.inl"
+#include "bcnrand_kernel.h"
 
 
 /*	
@@ -179,6 +194,21 @@ __device__ __inline__ double randCombined(uint64_t  * s, uint64_t  * s1)
 		return rnd*LCG_m_inv;
 }
 
+/*	
+ * randCombined53
+ * The combined generator with the resolution of a double: the same steps as randCombined,
+ * the variate is ((lcg 2^22 - bcn) mod 2^53) 2^-53
+ */
+__device__ __inline__ double randCombined53(uint64_t  * s, uint64_t  * s1)
+{
+	uint64_t rnd = randCombined53_increment(s, s1);
+	
+	if (rnd == 0)
+		return COMB_mask53*COMB_inv53;
+	else
+		return rnd*COMB_inv53;
+}
+
 /*	
  * Kernel_initGenerator
  * This kernel initialises the starting seed for each thread and writes them back to device global memory
@@ -190,10 +220,10 @@ __device__ __inline__ double randCombined(uint64_t  * s, uint64_t  * s1)
 __global__ void Kernel_initGenerator(uint64_t *md_SeedData, unsigned int WorkPerThread, uint64_t Seed)
 {
 	int tid = threadIdx.x + threadIdx.y * blockDim.x;
-	int gid = blockIdx.x * blockDim.x * blockDim.y * WorkPerThread + WorkPerThread * tid;
+	uint64_t gid = ((uint64_t)blockIdx.x * blockDim.x * blockDim.y + tid) * WorkPerThread;
 
-	//find my seed
-	Seed += 53.0 * gid;
+	//find my seed (in integers, a double loses bits of large positions)
+	Seed += 53 * gid;
 
 	md_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid] = BarrettInitBit(Seed);
 }
@@ -212,11 +242,12 @@ __global__ void Kernel_initGenerator(uint64_t *md_SeedData, unsigned int WorkPer
 __global__ void Kernel_initGeneratorCombined(uint64_t *md_SeedData, uint64_t *md_SeedData1, unsigned int WorkPerThread, uint64_t Seed)
 {
 	int tid = threadIdx.x + threadIdx.y * blockDim.x;
-	int gid = blockIdx.x * blockDim.x * blockDim.y * WorkPerThread + WorkPerThread * tid;
-	int Seed1=Seed;
+	uint64_t gid = ((uint64_t)blockIdx.x * blockDim.x * blockDim.y + tid) * WorkPerThread;
+	uint64_t Seed1=Seed;
 
-	//find my seed
-	Seed += 53.0 * gid;
+	//find my seed: the element gid is 53 gid bits further in the bcn sequence
+	//and gid steps further in the auxiliary lcg, as after gid calls of randCombined
+	Seed += 53 * gid;
 	Seed1+= gid;
 
 	seedCombined(Seed, Seed1, &(md_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid]),  &(md_SeedData1[blockIdx.x * blockDim.x * blockDim.y + tid]));
@@ -224,6 +255,208 @@ __global__ void Kernel_initGeneratorCombined(uint64_t *md_SeedData, uint64_t *md
 
 
 
+/* ================================= step policies ================================= */
+/* The generators of the kernels below, for run_stream (bcnrand_kernel.h). A policy is constructed
+   from the seed arrays and the index k of the thread in them (d_SeedData1 is only read by
+   combined_step); next() returns the next raw number, next_block<U> the next U ones, variate
+   the number on (0,1) and store writes it as double, float or the raw number (uint64_t). */
+
+/*	
+ * bcn_step
+ * The steps of bcnrandom_inline, raw numbers are the states
+ */
+struct bcn_step
+{
+	typedef uint64_t result_type;
+
+	uint64_t z;
+
+	__device__ bcn_step(const uint64_t* seeds, const uint64_t* seeds1, unsigned int k) : z(seeds[k]) {}
+
+	__device__ uint64_t next()
+	{
+		uint64_t qhi, qlo, r2lo;
+		barrett_step_opt(z);
+		return z;
+	}
+
+	template <int U>
+	__device__ void next_block(uint64_t* r)
+	{
+		#pragma unroll
+		for (int j = 0; j < U; j++)
+			r[j] = next();
+	}
+
+	__device__ double variate(uint64_t r) const { return BCN_minv * r; }
+
+	__device__ void store(double* p, uint64_t r) const { *p = BCN_minv * r; }
+	__device__ void store(float* p, uint64_t r) const { *p = (float)(BCN_minv * r); }
+	__device__ void store(uint64_t* p, uint64_t r) const { *p = r; }
+};
+
+/*	
+ * multistep_step
+ * The same numbers as bcn_step, a block of 8 is computed from the same state by independent
+ * multiplications with BCN_J (blocks of any size U are split in blocks of 8)
+ */
+struct multistep_step : bcn_step
+{
+	__device__ multistep_step(const uint64_t* seeds, const uint64_t* seeds1, unsigned int k) : bcn_step(seeds, seeds1, k) {}
+
+	template <int U>
+	__device__ void next_block(uint64_t* r)
+	{
+		#pragma unroll
+		for (int j = 0; j < U; j++)
+		{
+			r[j] = BarrettStep(z, BCN_J[j % 8]);
+			if (j % 8 == 7 || j == U - 1)
+				z = r[j];
+		}
+	}
+};
+
+/*	
+ * combined_step
+ * The steps of randCombined, or of randCombined53 with Bits = 53, raw numbers are rnd
+ */
+template <int Bits>
+struct combined_step
+{
+	typedef uint64_t result_type;
+
+	uint64_t z, z1;
+
+	__device__ combined_step(const uint64_t* seeds, const uint64_t* seeds1, unsigned int k) : z(seeds[k]), z1(seeds1[k]) {}
+
+	__device__ uint64_t next()
+	{
+		uint64_t rnd = Bits == 53 ? randCombined53_increment(&z, &z1) : randCombined_increment(&z, &z1);
+
+		if (rnd == 0)
+			return Bits == 53 ? COMB_mask53 : LCG_m1;
+		return rnd;
+	}
+
+	template <int U>
+	__device__ void next_block(uint64_t* r)
+	{
+		#pragma unroll
+		for (int j = 0; j < U; j++)
+			r[j] = next();
+	}
+
+	__device__ double variate(uint64_t r) const { return Bits == 53 ? r * COMB_inv53 : r * LCG_m_inv; }
+
+	__device__ void store(double* p, uint64_t r) const { *p = variate(r); }
+	__device__ void store(float* p, uint64_t r) const { *p = (float)variate(r); }
+	__device__ void store(uint64_t* p, uint64_t r) const { *p = r; }
+};
+
+/*	
+ * constant_step
+ * No generation: the seed of the thread converted to double, repeated (Kernel_Constant_Unrolled)
+ */
+struct constant_step
+{
+	typedef double result_type;
+
+	double c;
+
+	__device__ constant_step(const uint64_t* seeds, const uint64_t* seeds1, unsigned int k) : c(seeds[k]) {}
+
+	__device__ double next() { return c; }
+
+	template <int U>
+	__device__ void next_block(double* r)
+	{
+		#pragma unroll
+		for (int j = 0; j < U; j++)
+			r[j] = c;
+	}
+
+	__device__ double variate(double r) const { return r; }
+
+	__device__ void store(double* p, double r) const { *p = r; }
+};
+
+
+/* ================================= kernel family ================================= */
+
+/*	
+ * generate_strided
+ * The thread writes its WorkPerThread numbers of the generator Step to d_OutputData, in the layout
+ * of Kernel_Opt: with T threads per block, the element i of the thread tid of the block b is at
+ * (b T WorkPerThread + tid + i T), so that the threads of a block write consecutive addresses.
+ * Unroll numbers are generated per iteration; WorkPerThread needs not be a multiple of Unroll.
+ */
+template <class Step, int Unroll, class T>
+__device__ void generate_strided(T *d_OutputData, uint64_t *d_SeedData, uint64_t *d_SeedData1, unsigned int WorkPerThread)
+{
+	int tid = threadIdx.x + threadIdx.y * blockDim.x;
+	int step = blockDim.x * blockDim.y;
+
+	Step s(d_SeedData, d_SeedData1, blockIdx.x * step + tid);
+	bcn::strided_output<T> out = bcn::make_strided_output(d_OutputData + (size_t)blockIdx.x * step * WorkPerThread + tid, (size_t)step);
+
+	bcn::run_stream<Unroll>(s, out, WorkPerThread);
+}
+
+/*	
+ * count_block
+ * The thread counts its WorkPerThread variates u of the generator Step with pred(u) true, and
+ * results[blockIdx.x] is the count of the block (shared memory of one unsigned int per thread)
+ */
+template <class Step, int Unroll, class Pred>
+__device__ void count_block(unsigned int * const results, uint64_t *d_SeedData, uint64_t *d_SeedData1, unsigned int WorkPerThread, Pred pred)
+{
+	extern __shared__ unsigned int sdata[];
+
+	int tid = threadIdx.x + threadIdx.y * blockDim.x;
+	int step = blockDim.x * blockDim.y;
+
+	Step s(d_SeedData, d_SeedData1, blockIdx.x * step + tid);
+	bcn::count_output<Pred> out = bcn::make_count_output(pred);
+
+	bcn::run_stream<Unroll>(s, out, WorkPerThread);
+
+	sdata[tid] = out.count;
+	__syncthreads();
+
+	// add the result slowly!
+	if (tid == 0)
+	{
+		for (int i = 1 ; i < step ; i++) 
+			out.count += sdata[i];
+
+		results[blockIdx.x] = out.count;
+	}
+}
+
+/*	
+ * Kernel_Generate, Kernel_Count
+ * The kernels of any generator (step policy), output type and unroll factor, e.g.
+ *		Kernel_Generate<combined_step<53>, 4><<<dimGrid, dimBlock>>>(d_OutputData, d_SeedData, d_SeedData1, workPerThread);
+ *		bcn::below b = { 0.5 };
+ *		Kernel_Count<multistep_step, 8><<<dimGrid, dimBlock, dimBlock.x * sizeof(unsigned int)>>>(d_OutputData, d_SeedData, 0, workPerThread, b);
+ * A kernel with another use of the numbers calls bcn::run_stream with its own output policy
+ * (e.g. bcn::functor_output).
+ */
+template <class Step, int Unroll, class T>
+__global__ void Kernel_Generate(T *d_OutputData, uint64_t *d_SeedData, uint64_t *d_SeedData1, unsigned int WorkPerThread)
+{
+	generate_strided<Step, Unroll>(d_OutputData, d_SeedData, d_SeedData1, WorkPerThread);
+}
+
+template <class Step, int Unroll, class Pred>
+__global__ void Kernel_Count(unsigned int * const results, uint64_t *d_SeedData, uint64_t *d_SeedData1, unsigned int WorkPerThread, Pred pred)
+{
+	count_block<Step, Unroll>(results, d_SeedData, d_SeedData1, WorkPerThread, pred);
+}
+
+
+
 /* ============================================================================================== */
 /* The methods below are essentially illustrative examples of how bcnrandom_inline() can be used */
 
@@ -237,32 +470,10 @@ __global__ void Kernel_initGeneratorCombined(uint64_t *md_SeedData, uint64_t *md
  */
 __global__ void Kernel_CountValues(unsigned int * const results, uint64_t *d_SeedData, const unsigned int WorkPerThread)
 {
-	extern __shared__ unsigned int sdata[];
-	
-    unsigned int tid = blockIdx.x * blockDim.x + threadIdx.x;
-	
-	//get starting seed
-	uint64_t seed = (uint64_t)d_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid];
-	
-    // Count the number of numbers less than 0.9
-    unsigned long int count = 0;
-    for (int i = 0 ; i < WorkPerThread ; i++)
-    {
-        if( bcnrandom_inline(&seed)<0.9 )
-            count++;
-    }
-
-    sdata[threadIdx.x] = count;
-    __syncthreads();
-
-    // add the result slowly!
-    if (threadIdx.x == 0)
-    {
-    	for (int i = 1 ; i < blockDim.x ; i++) 
-	    	count += sdata[i];
-        
-        results[blockIdx.x] = count;
-    }
+	// Count the number of numbers less than 0.9
+	bcn::below b = { 0.9 };
+
+	count_block<bcn_step, 8>(results, d_SeedData, 0, WorkPerThread, b);
 }
 
 
@@ -276,44 +487,54 @@ __global__ void Kernel_CountValues(unsigned int * const results, uint64_t *d_See
  */
 __global__ void Kernel_Opt(double *d_OutputData, uint64_t *d_SeedData, unsigned int WorkPerThread)
 {
-    int tid = threadIdx.x + threadIdx.y * blockDim.x;
-	int gid = blockIdx.x * blockDim.x * blockDim.y * WorkPerThread + tid;
-	int step = blockDim.x * blockDim.y;
-	int istep;
-	
-	uint64_t qhi, qlo, r2lo, rlo;
-	
-	//get starting seed
-	rlo = (uint64_t)d_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid];
+	//Calculate successive members of sequence, 8 per iteration
+	generate_strided<bcn_step, 8>(d_OutputData, d_SeedData, 0, WorkPerThread);
+}
 
-	//Calculate successive members of sequence.
-	for(int i = 0; i < WorkPerThread; i+=8)
+/*	
+ * Kernel_Opt_Multistep
+ * The same as Kernel_Opt, but the 8 successive members are not a chain of 8 dependent barrett steps:
+ * z_k+j = 2^(53 j) z_k mod 3^33 (BCN_J) are computed independently from z_k, and z_k+8 is the next z_k.
+ * Parameters: 
+ * 	d_OutputData: 	output, contains calculated random variates
+ *	d_SeedData: 	input, contains precomputed seeds for each thread
+ *	WorkPerThread: 	input, length of each subsequence 
+ */
+__global__ void Kernel_Opt_Multistep(double *d_OutputData, uint64_t *d_SeedData, unsigned int WorkPerThread)
+{
+	generate_strided<multistep_step, 8>(d_OutputData, d_SeedData, 0, WorkPerThread);
+}
+
+/*	
+ * Kernel_Leapfrog
+ * This kernel generates random numbers in the leapfrog mode: with T threads in the grid, the thread gid
+ * generates the elements gid, gid+T, gid+2T, ... of the sequence by multiplying its iterate by
+ * 2^(53 T) mod 3^33, so that d_OutputData[i] is the element i of the sequence and consecutive threads
+ * write consecutive (coalesced) addresses.
+ * Parameters: 
+ * 	d_OutputData: 	output, contains calculated random variates, T*WorkPerThread elements
+ *	d_SeedData: 	input, contains precomputed seeds for each thread, Kernel_initGenerator with WorkPerThread = 1
+ *	WorkPerThread: 	input, number of elements per thread (any value)
+ */
+__global__ void Kernel_Leapfrog(double *d_OutputData, uint64_t *d_SeedData, unsigned int WorkPerThread)
+{
+	int tid = threadIdx.x + threadIdx.y * blockDim.x;
+	uint64_t gid = (uint64_t)blockIdx.x * blockDim.x * blockDim.y + tid;
+	uint64_t step = (uint64_t)gridDim.x * blockDim.x * blockDim.y;
+
+	uint64_t qhi, qlo, r2lo, rlo, leap;
+
+	//multiplier of the leapfrog, 2^(53 T) mod 3^33
+	leap = BarrettSkip(1, step);
+
+	//get starting seed, the element gid is the next one
+	rlo = d_SeedData[gid];
+	barrett_step_opt(rlo);
+
+	for (unsigned int i = 0; i < WorkPerThread; i++)
 	{
-		istep = gid+i*step;
-		
-		barrett_step_opt(rlo);	
-		d_OutputData[istep] = BCN_minv * rlo;
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step] = BCN_minv *  rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*2] = BCN_minv *  rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*3] = BCN_minv * rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*4] = BCN_minv * rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*5] = BCN_minv * rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*6] = BCN_minv * rlo;			
-		
-		barrett_step_opt(rlo);
-		d_OutputData[istep+step*7] = BCN_minv * rlo;
+		d_OutputData[gid + i * step] = BCN_minv * rlo;
+		rlo = BarrettStep(rlo, leap);
 	}
 }
 
@@ -328,30 +549,7 @@ __global__ void Kernel_Opt(double *d_OutputData, uint64_t *d_SeedData, unsigned
  */
 __global__ void Kernel_Constant_Unrolled(double *d_OutputData, uint64_t *d_SeedData, unsigned int WorkPerThread)
 {
-    int tid = threadIdx.x + threadIdx.y * blockDim.x;
-	int gid = blockIdx.x * blockDim.x * blockDim.y * WorkPerThread + tid;
-	int step = blockDim.x * blockDim.y;
-	
-	double rlo;
-	int istep;
-	
-	//get starting seed
-	rlo = d_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid];
-
-	//Calculate successive members of sequence.
-	for(int i = 0; i < WorkPerThread; i+=8)
-	{
-		istep = gid+i*step;
-		
-		d_OutputData[istep] = rlo;
-		d_OutputData[istep+step] = rlo;		
-		d_OutputData[istep+step*2] = rlo;		
-		d_OutputData[istep+step*3] = rlo;		
-		d_OutputData[istep+step*4] = rlo;			
-		d_OutputData[istep+step*5] = rlo;			
-		d_OutputData[istep+step*6] = rlo;			
-		d_OutputData[istep+step*7] = rlo;
-	}
+	generate_strided<constant_step, 8>(d_OutputData, d_SeedData, 0, WorkPerThread);
 }
 
 /*	
@@ -448,19 +646,28 @@ void TimeBCNMethod(unsigned int numElements, double seed, unsigned int numThread
 	cudaEventSynchronize(setupEnd);
 	cudaEventElapsedTime(&setupTime, setupStart, setupEnd);
 	
-	executeTimeSum = 0;
-	for(unsigned int i = 0; i < numIterations; i++) 
-    {
-	    executeTime = 0;
-		cudaEventRecord(executeStart, 0);
+	//the dependent chain of Kernel_Opt, then the independent steps of Kernel_Opt_Multistep
+	float executeTimes[2];
+	for (int kernel = 0; kernel < 2; kernel++)
+	{
+		executeTimeSum = 0;
+		for(unsigned int i = 0; i < numIterations; i++) 
+	    {
+		    executeTime = 0;
+			cudaEventRecord(executeStart, 0);
 		
-		//execute the kernel
-		Kernel_Opt<<< dimGrid, dimBlock >>>(d_OutputData, d_SeedData, workPerThread);
+			//execute the kernel
+			if (kernel == 0)
+				Kernel_Opt<<< dimGrid, dimBlock >>>(d_OutputData, d_SeedData, workPerThread);
+			else
+				Kernel_Opt_Multistep<<< dimGrid, dimBlock >>>(d_OutputData, d_SeedData, workPerThread);
 		
-		cudaEventRecord(executeEnd, 0);
-		cudaEventSynchronize(executeEnd);
-		cudaEventElapsedTime(&executeTime, executeStart, executeEnd);
-		executeTimeSum +=executeTime;
+			cudaEventRecord(executeEnd, 0);
+			cudaEventSynchronize(executeEnd);
+			cudaEventElapsedTime(&executeTime, executeStart, executeEnd);
+			executeTimeSum +=executeTime;
+		}
+		executeTimes[kernel] = executeTimeSum;
 	}
 	
 	//free device mem
@@ -473,8 +680,11 @@ void TimeBCNMethod(unsigned int numElements, double seed, unsigned int numThread
 	cudaEventDestroy(executeStart);
 	cudaEventDestroy(executeEnd);
 	
-	//Print Results
-	printf("BCN method, %f GNum/Sec, %f ms Execute Time, %f ms Setup Time\n", (1/(executeTimeSum/(numIterations*1.0)))*numElements/1000000, executeTimeSum/(numIterations*1.0), setupTime);
+	//Print Results: the times are in ms per run, numElements / (ms 10^-3) / 10^9 numbers per second
+	for (int kernel = 0; kernel < 2; kernel++)
+		executeTimes[kernel] /= numIterations;
+	printf("BCN method, %f GNum/Sec, %f ns/Num, %f ms Execute Time, %f ms Setup Time\n", numElements / (executeTimes[0] * 1e-3) / 1e9, executeTimes[0] * 1e6 / numElements, executeTimes[0], setupTime);
+	printf("BCN method (multistep), %f GNum/Sec, %f ns/Num, %f ms Execute Time\n", numElements / (executeTimes[1] * 1e-3) / 1e9, executeTimes[1] * 1e6 / numElements, executeTimes[1]);
 }
 
 
@@ -493,34 +703,10 @@ void TimeBCNMethod(unsigned int numElements, double seed, unsigned int numThread
  */
 __global__ void Kernel_CountValues_Combined(unsigned int * const results, uint64_t *d_SeedData, uint64_t *d_SeedData1, const unsigned int WorkPerThread)
 {
-	extern __shared__ unsigned int sdata[];
-	
-    unsigned int tid = blockIdx.x * blockDim.x + threadIdx.x;
-	
-	//get starting seed
-	uint64_t seed = (uint64_t)d_SeedData[blockIdx.x * blockDim.x * blockDim.y + tid];
-	//get starting seed (we need two seeds)
-	uint64_t seed1 = (uint64_t)d_SeedData1[blockIdx.x * blockDim.x * blockDim.y + tid];
-	
-    // Count the number of numbers less than 0.9
-    unsigned int count = 0;
-    for (int i = 0 ; i < WorkPerThread ; i++)
-    {
-        if( randCombined(&seed, &seed1)<0.9 )
-            count++;
-    }
-
-    sdata[threadIdx.x] = count;
-    __syncthreads();
-
-    // add the result slowly!
-    if (threadIdx.x == 0)
-    {
-    	for (int i = 1 ; i < blockDim.x ; i++) 
-	    	count += sdata[i];
-        
-        results[blockIdx.x] = count;
-    }
+	// Count the number of numbers less than 0.9 (we need two seeds)
+	bcn::below b = { 0.9 };
+
+	count_block<combined_step<31>, 8>(results, d_SeedData, d_SeedData1, WorkPerThread, b);
 }
 
 
@@ -15,6 +15,7 @@ static const uint64_t	BCN_r    = ULL(5946243);				/* r = m % a */
 static const uint64_t	BCN_mulo = ULL(0x33D9481681D79D);
 static const uint64_t	BCN_q    = ULL(165672915);              /* m div a   */
 static const uint64_t	BCN_t	 = ULL(2779530283277761);		/* floor(m/2) */
+static const uint64_t	BCN_period = ULL(3706040377703682);		/* 2 3^32, period of the sequence */
 
 static const double	BCN_qinv = 6.0359896486399119614693807977001e-9;	/* 1.0 / (double)(BCN_q); */
 static const double	BCN_minv = 1.7988650924514300510763861722128e-16;	/* 1.0 / (double)(BCN_m); */
@@ -26,12 +27,19 @@ static const double BCN_b	 = 9007199254740992.0;						/* 2^53 */
 static const int64_t 	LCG_m 		= 2147483649;								/* m = 2^31 + 1  	*/
 static const int64_t 	LCG_m1 		= 2147483648;								/* m - 1			*/
 static const int64_t 	LCG_a 		= 39373;									/* a = 39373  		*/
+static const int64_t 	LCG_period 	= 119304647;								/* period of the lcg */
 static const int64_t 	LCG_q 		= 54542;									/* q = floor m / a  */
 static const double 	LCG_qinv 	= 1.8334494517986139122144402478824e-5; 	/* 1/q 				*/
 static const int64_t 	LCG_r 		= 1483;										/* r =  m mod a  	*/
 static const double 	LCG_m_inv 	= 4.6566128709089882341637330901978e-10;	/* 1/m 				*/
 static const int64_t	LCG_t		= 1073741824;								/* floor(m/2) */
 
+/*
+	Constants used in the 53 bit combined generator
+*/
+static const uint64_t 	COMB_mask53	= ULL(9007199254740991);					/* 2^53 - 1			*/
+static const double 	COMB_inv53	= 1.1102230246251565404236316680908e-16;	/* 2^-53			*/
+
 
 #define BCN_t53 9007199254740992						//exp2(53.0);
 //#define BCN_tp 1.6202736320108106429874177483778
@@ -175,8 +183,8 @@ __device__ inline int64_t LCN_Inline(int64_t seed)
 
 	INPUTS
 		k:	64 bit unsigned integer containing the
-			lcg generator seed value in the range
-			[0,2^53 - 3^33 - 100]
+			lcg generator seed value (any value, it
+			is reduced modulo the period 2 3^32)
 	OUTPUTS
 			64 bit unsigned integer type containing
 			the final iterator of the lcg seed
@@ -206,7 +214,10 @@ __constant__ uint64_t BCN_R[11][32] =
 __device__ __inline__ uint64_t BarrettInitBit(uint64_t k)
 {
 	uint32_t	i = 0;
-	uint64_t	q = 0x1ULL << (k & 0x1F);
+	uint64_t	q;
+
+	k %= BCN_period;
+	q = 0x1ULL << (k & 0x1F);
 
 	for (i = 0; i < 11; i++)
 	{
@@ -218,9 +229,87 @@ __device__ __inline__ uint64_t BarrettInitBit(uint64_t k)
 }
 
 
+/*!
+ ---------------------------------------------
+	Function: BarrettSkip
+
+	INPUTS
+		z:	64 bit unsigned integer containing the
+			current iterate z_k of the generator
+		n:	64 bit unsigned integer, number of steps
+	OUTPUTS
+			64 bit unsigned integer containing z_k+n,
+			the same value as after n calls of
+			barrett_step_opt
+ ---------------------------------------------
+	NOTES
+			z_k+n = 2^(53 n) z_k mod 3^33. n is reduced
+			modulo the period 2 3^32 < 2^52, then z_k is
+			multiplied by BCN_P[i] = 2^(53 2^i) mod 3^33
+			for every bit i of n (at most 52 Barrett steps)
+ ---------------------------------------------
+*/
+__constant__ uint64_t BCN_P[52] =
+	{
+		3448138688185469ULL, 5239873117944745ULL,  656008114015039ULL, 5082487144908073ULL,
+		4861768969271749ULL, 1644422298634123ULL, 3351909309438892ULL, 2035921318756999ULL,
+		5240730634506364ULL, 4732467724655845ULL, 3532026657505009ULL, 2356902510989119ULL,
+		3096939073751095ULL, 2569498123830685ULL,  570456985230859ULL, 5051898109648366ULL,
+		 909319727102755ULL, 4779942483637978ULL, 3081424099833166ULL, 2661455464350748ULL,
+		1356725036587801ULL, 4536388266770869ULL, 4654194529161541ULL, 2916451880868760ULL,
+		2602491974454406ULL,  142940067240913ULL, 3963885392607844ULL, 3685603751434789ULL,
+		1272497572635592ULL, 2771727629850034ULL, 2946244638184969ULL, 2810649183742483ULL,
+		5250731765857816ULL, 1401960484250845ULL, 1067425837712878ULL, 1957217160697819ULL,
+		1335729368340535ULL, 3216143365255591ULL, 2492751493594255ULL, 2894294763378772ULL,
+		 427039234234555ULL, 5282888695843192ULL, 2864106654698902ULL, 4754403997187119ULL,
+		 180234224728114ULL, 2967424372729771ULL, 4951522522358320ULL, 1397920850881342ULL,
+		2708857017012874ULL, 3172432511816179ULL, 3966297054481570ULL,  226845704012155ULL
+	};
+
+__device__ __inline__ uint64_t BarrettSkip(uint64_t z, uint64_t n)
+{
+	uint32_t	i;
+
+	n %= BCN_period;
+	for (i = 0; n; i++, n >>= 1)
+		if (n & 1)
+			z = BarrettStep(z, BCN_P[i]);
+
+	return z;
+}
+
+/*
+	BCN_J[j-1] = 2^(53 j) mod 3^33, j = 1..8: the iterates z_k+1..z_k+8 are
+	BarrettStep(z_k, BCN_J[j-1]), independent of each other (Kernel_Opt_Multistep)
+*/
+__constant__ uint64_t BCN_J[8] =
+	{
+		3448138688185469ULL, 5239873117944745ULL, 4191761301578774ULL,  656008114015039ULL,
+		1182240484383881ULL, 5169524617868482ULL, 1742904838367195ULL, 5082487144908073ULL
+	};
+
+
 
 /* ========= auxiliary generator =============*/
 
+/*!
+ ---------------------------------------------
+	Function: LCGMod
+
+	INPUTS
+		x:	64 bit unsigned integer, x <= 2^62
+	OUTPUTS
+			x mod (2^31+1), without the 64 bit
+			division of %: x = h 2^31 + l = l - h
+ --------------------------------------------- 
+*/
+__device__ __inline__ uint64_t	LCGMod(uint64_t	x)
+{
+	int64_t r = (int64_t)(x & ULL(0x7FFFFFFF)) - (int64_t)(x >> 31);
+
+	return (uint64_t)(r < 0 ? r + LCG_m : r);
+}
+
 /*!
  ---------------------------------------------
 	Function: LCGStep
@@ -239,7 +328,7 @@ __device__ __inline__ uint64_t BarrettInitBit(uint64_t k)
 */
 __device__ __inline__ uint64_t	LCGStep(uint64_t	s, uint64_t	a)
 {
-	return (a * s) % LCG_m;
+	return LCGMod(a * s);
 }
 
 /*!
@@ -248,13 +337,20 @@ __device__ __inline__ uint64_t	LCGStep(uint64_t	s, uint64_t	a)
 
 	INPUTS
 		k:	64 bit unsigned integer containing the
-			lcg generator seed value in the range
-			[0,2^31-1]
+			lcg generator seed value (any value, it
+			is reduced modulo the period 119304647)
 	OUTPUTS
 			64 bit unsigned integer type containing
 			the final iterator of the lcg seed
 			algorithm
  --------------------------------------------- 
+	NOTES
+			BCN_AUX_R[i][j] = 39373^(j*32^i) mod (2^31+1).
+			The period of the lcg is 119304647, a divisor
+			of 2^30 - 1, so 39373^(32^6) = 39373 and the
+			rows 6-11 repeat the rows 0-5. The result is
+			39373^(k+1) mod (2^31+1) for every k.
+ ---------------------------------------------
 */
 
 __constant__ uint64_t BCN_AUX_R[12][32] = 
@@ -279,6 +375,8 @@ __device__ __inline__ uint64_t LCGInitBit(uint64_t k)
 	uint32_t	i = 0;
 	uint64_t	q = (1ULL);// << (k & 0x1F);
 
+	k %= LCG_period;
+
 	for (i = 0; i < 11; i++)
 	{
 		q = LCGStep(q,BCN_AUX_R[i][k & 0x1F]);
@@ -289,6 +387,47 @@ __device__ __inline__ uint64_t LCGInitBit(uint64_t k)
 }
 
 
+/*!
+ ---------------------------------------------
+	Function: LCGSkip
+
+	INPUTS
+		s:	64 bit unsigned integer containing the
+			current iterate s_k of the lcg
+		n:	64 bit unsigned integer, number of steps
+	OUTPUTS
+			64 bit unsigned integer containing s_k+n,
+			the same value as after n calls of
+			randlcgSimple_increment
+ ---------------------------------------------
+	NOTES
+			s_k+n = 39373^n s_k mod (2^31+1), with n
+			reduced modulo the period 119304647 < 2^27
+			and LCG_P[i] = 39373^(2^i) mod (2^31+1)
+ ---------------------------------------------
+*/
+__constant__ uint64_t LCG_P[27] =
+	{
+		     39373ULL, 1550233129ULL, 1953748441ULL,  296121733ULL, 1174390633ULL, 1379575543ULL,
+		 469631365ULL,  198127207ULL, 1810121248ULL, 1059278440ULL,  424591189ULL, 1003159306ULL,
+		2045675353ULL,  518277262ULL,  302749087ULL,  210843040ULL, 1228916023ULL, 1561646362ULL,
+		 499383703ULL, 2119291921ULL,  566549329ULL, 1761804235ULL,  781918015ULL, 1830950671ULL,
+		 184785544ULL,  730155415ULL,  927030997ULL
+	};
+
+__device__ __inline__ uint64_t LCGSkip(uint64_t s, uint64_t n)
+{
+	uint32_t	i;
+
+	n %= LCG_period;
+	for (i = 0; n; i++, n >>= 1)
+		if (n & 1)
+			s = LCGStep(s, LCG_P[i]);
+
+	return s;
+}
+
+
 /*!
  ---------------------------------------------
 	Function: seedlcg
@@ -316,6 +455,29 @@ __device__ __inline__ void seedCombined(uint64_t count, uint64_t count1, uint64_
 }
 
 
+/*!
+ ---------------------------------------------
+	Function: skipCombined
+
+	INPUTS
+		seed, lcgseed:	pointers to the two seeds of the
+						combined generator
+		n:				number of steps
+	OUTPUTS
+		nil
+ ---------------------------------------------
+	NOTES:
+		Updates both seeds as n calls of randCombined_increment,
+		the bcn part by BarrettSkip and the lcg part by LCGSkip
+ ---------------------------------------------
+*/
+__device__ __inline__ void skipCombined(uint64_t* seed, uint64_t* lcgseed, uint64_t n)
+{
+	*seed=BarrettSkip(*seed, n);
+	*lcgseed=LCGSkip(*lcgseed, n);
+}
+
+
 
 
 /*!
@@ -339,7 +501,7 @@ __device__ __inline__ void seedCombined(uint64_t count, uint64_t count1, uint64_
 */
 __device__ __inline__ uint64_t randlcgSimple_increment( uint64_t *z )
 {
-	return *z = (LCG_a * *z) % LCG_m;
+	return *z = LCGMod(LCG_a * *z);
 }
 
 /*!
@@ -364,6 +526,28 @@ __device__ __inline__ uint64_t randCombined_increment(uint64_t *SeedBCN_z_k, uin
 	return (int64_t)(randlcgSimple_increment(SeedLCG_z_k) -  *SeedBCN_z_k) & ULL(0x7FFFFFFF); //800000007FFFFFFF
 }
 
+/*!
+ ---------------------------------------------
+	Function: randCombined53_increment
+
+	INPUTS
+				pointers to 64 bit integer
+				containing the k'th iterate beyond
+				the seed iterate
+	OUTPUTS
+		rnd:	64 bit uint64_t type, 53 bits
+ ---------------------------------------------
+	COMPUTES:
+		rnd = LCG() 2^22 - BCN() mod 2^53
+ --------------------------------------------- 
+*/
+__device__ __inline__ uint64_t randCombined53_increment(uint64_t *SeedBCN_z_k, uint64_t *SeedLCG_z_k)
+{
+	uint64_t qhi, qlo, r2lo;
+	barrett_step_opt(*SeedBCN_z_k);
+	return ((randlcgSimple_increment(SeedLCG_z_k) << 22) - *SeedBCN_z_k) & COMB_mask53;
+}
+
 
 
 
@@ -0,0 +1,426 @@
+/* ************************************************************************** */
+/* * bcnrand_bench.cpp                                                      * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*
+ * Benchmark of the host (CPU) version of bcnrand, the counterpart of TimeBCNMethod
+ *
+ * Call from the command line:  ./bcnrand_bench 16777216 8 > results.json
+ * arguments (optional): the largest array size of the fill benchmark (default 2^24),
+ * the largest number of threads (default the size of the pool, BCNRAND_THREADS)
+ *
+ * The results are written to stdout as one JSON object, to be kept and compared
+ * between versions:
+ *	"steps":		every step of the generator, one dependent chain per test (as in Kernel_Opt),
+ *					the engines of bcn::generate and the combined generator
+ *	"seeding":		the seeds of nstreams streams (Kernel_initGenerator): BarrettInitBit,
+ *					LCGInitBit and seedCombined per stream, and build_seed_array
+ *	"fill":			bcn::fill of double and float arrays, and bcn::fill_combined of double arrays,
+ *					vs. the size and the number of threads
+ *	"roofline":		memset and memcpy of the same arrays with the same threads, the speed of
+ *					light of the fill (the role of Kernel_Constant_Unrolled on the GPU)
+ *	"stats":		with -DBCN_STATS, the counters of bcnrand_stats.h over the run
+ *
+ * Every record has ns_per_number (per seed for the seeding), cycles_per_number
+ * (time stamp counter cycles, null where there is none), and gb_per_s (bytes written
+ * per second, 8 per double, 10^9 bytes in a GB). Each test is repeated for at least
+ * BENCH_MIN_TIME seconds and the best of BENCH_RUNS runs is reported. "check" is a sum
+ * of the generated numbers, so that the work cannot be optimised away (and a change of
+ * the sequence shows up).
+ *
+ *	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+ */
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+#include "bcnrand_host.h"
+#include "bcnrand_fill.h"
+
+using namespace bcn;
+
+static const double	BENCH_MIN_TIME = 0.05;		/* seconds per run */
+static const int	BENCH_RUNS = 3;
+static const size_t	BENCH_STEP_N = 4096;		/* numbers per call in the step tests, fits in L1 */
+static const uint64_t BENCH_SEED = 112;
+
+
+/* ================================ timing ================================= */
+
+struct timing
+{
+	double	ns;			/* per number */
+	double	cycles;		/* per number, < 0 if there is no counter */
+};
+
+static inline uint64_t read_tsc()
+{
+#if defined(BENCH_HAVE_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * measure
+ * Runs f() (which produces count numbers) repeatedly for at least BENCH_MIN_TIME,
+ * the best of BENCH_RUNS runs
+ */
+template <class F>
+timing measure(uint64_t count, F f)
+{
+	typedef std::chrono::steady_clock clock;
+	timing best = { 1e300, 1e300 };
+
+	f();	// warm up, page faults
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		uint64_t	reps = 0, c0 = read_tsc();
+		double		sec;
+		clock::time_point t0 = clock::now();
+
+		do
+		{
+			f();
+			reps++;
+			sec = std::chrono::duration<double>(clock::now() - t0).count();
+		} while (sec < BENCH_MIN_TIME);
+
+		uint64_t c1 = read_tsc();
+		double n = (double)reps * count;
+
+		if (sec * 1e9 / n < best.ns)
+		{
+			best.ns = sec * 1e9 / n;
+			best.cycles = (c1 - c0) / n;
+		}
+	}
+#if !defined(BENCH_HAVE_TSC)
+	best.cycles = -1;
+#endif
+	return best;
+}
+
+
+/* ================================= output ================================ */
+
+static bool first_record;
+
+static void begin_section(const char* name)
+{
+	printf(",\n  \"%s\": [", name);
+	first_record = true;
+}
+
+static void end_section()
+{
+	printf("\n  ]");
+}
+
+/* one record: the fields given in fmt, then the timing, bytes_per_number written per number */
+static void record(const timing& t, double bytes_per_number, const char* fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static void record(const timing& t, double bytes_per_number, const char* fmt, ...)
+{
+	va_list args;
+
+	printf("%s\n    { ", first_record ? "" : ",");
+	first_record = false;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	printf(", \"ns_per_number\": %.4f, ", t.ns);
+	if (t.cycles >= 0)
+		printf("\"cycles_per_number\": %.3f, ", t.cycles);
+	else
+		printf("\"cycles_per_number\": null, ");
+	printf("\"gb_per_s\": %.3f }", bytes_per_number / t.ns);	// bytes per ns = GB/s
+	fflush(stdout);
+}
+
+
+/* ============================== the tests ================================= */
+
+static double check;	/* keeps the results alive */
+
+/* a dependent chain of one step function, as in Kernel_Opt */
+template <class Step>
+static void bench_step(const char* name, Step step)
+{
+	static double	x[BENCH_STEP_N];
+	uint64_t		z = BarrettInitBit(BENCH_SEED);
+
+	timing t = measure(BENCH_STEP_N, [&]
+	{
+		for (size_t i = 0; i < BENCH_STEP_N; i++)
+			x[i] = BCN_minv * (z = step(z));
+		check += x[BENCH_STEP_N - 1];
+	});
+	record(t, sizeof(double), "\"name\": \"%s\"", name);
+}
+
+template <class T>
+static void bench_generate(const char* name, lanes_kernel_t<T> kernel, bool multistep)
+{
+	static T	x[BENCH_STEP_N];
+	uint64_t	z = BarrettInitBit(BENCH_SEED);
+
+	timing t = measure(BENCH_STEP_N, [&]
+	{
+		if (multistep)
+			generate_multistep(z, x, BENCH_STEP_N);
+		else
+			generate(z, x, BENCH_STEP_N, kernel);
+		check += (double)x[BENCH_STEP_N - 1];
+	});
+	record(t, sizeof(T), "\"name\": \"%s\"", name);
+}
+
+static void bench_steps()
+{
+	const uint64_t	a = pow2_53(1);		// 2^53 mod m, the multiplier of one step
+
+	begin_section("steps");
+
+	bench_step("barrett_step_simple", [](uint64_t z) { return barrett_step_simple(z); });
+	bench_step("barrett_step_opt", [](uint64_t z) { return barrett_step_opt(z); });
+	bench_step("BarrettStep", [a](uint64_t z) { return BarrettStep(z, a); });
+	bench_step("LCN_Inline", [](uint64_t z) { return (uint64_t)LCN_Inline((int64_t)z); });
+
+	bench_generate<double>("generate_multistep", 0, true);
+	for (int isa = ISA_SCALAR; isa <= cpu_isa(); isa++)
+	{
+		char name[64];
+
+		snprintf(name, sizeof(name), "generate_%s", isa_name((simd_isa)isa));
+		bench_generate<double>(name, get_lanes_kernel<double>((simd_isa)isa), false);
+		snprintf(name, sizeof(name), "generate_%s_float", isa_name((simd_isa)isa));
+		bench_generate<float>(name, get_lanes_kernel<float>((simd_isa)isa), false);
+	}
+
+	{
+		static double	x[BENCH_STEP_N];
+		uint64_t		s, s1;
+
+		seedCombined(BENCH_SEED, BENCH_SEED, &s, &s1);
+		timing t = measure(BENCH_STEP_N, [&]
+		{
+			for (size_t i = 0; i < BENCH_STEP_N; i++)
+				x[i] = randCombined(&s, &s1);
+			check += x[BENCH_STEP_N - 1];
+		});
+		record(t, sizeof(double), "\"name\": \"randCombined\"");
+	}
+
+	for (int isa = ISA_SCALAR; isa <= cpu_isa(); isa++)
+	{
+		static double			x[BENCH_STEP_N];
+		combined_kernel_t<double> kernel = get_combined_kernel<double>((simd_isa)isa);
+		uint64_t				s, s1;
+
+		seedCombined(BENCH_SEED, BENCH_SEED, &s, &s1);
+		timing t = measure(BENCH_STEP_N, [&]
+		{
+			generate_combined(s, s1, x, BENCH_STEP_N, kernel);
+			check += x[BENCH_STEP_N - 1];
+		});
+		record(t, sizeof(double), "\"name\": \"generate_combined_%s\"", isa_name((simd_isa)isa));
+	}
+
+	{
+		static double	x[BENCH_STEP_N];
+		uint64_t		s, s1;
+
+		seedCombined(BENCH_SEED, BENCH_SEED, &s, &s1);
+		timing t = measure(BENCH_STEP_N, [&]
+		{
+			generate_combined<53>(s, s1, x, BENCH_STEP_N);
+			check += x[BENCH_STEP_N - 1];
+		});
+		record(t, sizeof(double), "\"name\": \"generate_combined53\"");
+	}
+
+	end_section();
+}
+
+/* the seeds of nstreams streams of workPerThread elements (Kernel_initGenerator) */
+static void bench_seeding()
+{
+	static const uint64_t work = 1 << 20;
+	std::vector<uint64_t> seeds(1 << 20), lcg(1 << 20);
+
+	begin_section("seeding");
+	for (uint64_t nstreams = 1; nstreams <= seeds.size(); nstreams *= 16)
+	{
+		timing t;
+
+		t = measure(nstreams, [&]
+		{
+			for (uint64_t i = 0; i < nstreams; i++)
+				seeds[i] = BarrettInitBit(BENCH_SEED + 53 * work * i);
+			check += seeds[nstreams - 1];
+		});
+		record(t, sizeof(uint64_t), "\"name\": \"BarrettInitBit\", \"streams\": %llu", (unsigned long long)nstreams);
+
+		t = measure(nstreams, [&]
+		{
+			for (uint64_t i = 0; i < nstreams; i++)
+				lcg[i] = LCGInitBit(BENCH_SEED + work * i);
+			check += lcg[nstreams - 1];
+		});
+		record(t, sizeof(uint64_t), "\"name\": \"LCGInitBit\", \"streams\": %llu", (unsigned long long)nstreams);
+
+		t = measure(nstreams, [&]
+		{
+			for (uint64_t i = 0; i < nstreams; i++)
+				seedCombined(BENCH_SEED + 53 * work * i, BENCH_SEED + work * i, &seeds[i], &lcg[i]);
+			check += seeds[nstreams - 1];
+		});
+		record(t, 2 * sizeof(uint64_t), "\"name\": \"seedCombined\", \"streams\": %llu", (unsigned long long)nstreams);
+
+		t = measure(nstreams, [&]
+		{
+			build_seed_array(seeds.data(), nstreams, BENCH_SEED, work);
+			check += seeds[nstreams - 1];
+		});
+		record(t, sizeof(uint64_t), "\"name\": \"build_seed_array\", \"streams\": %llu, \"threads\": %u",
+			   (unsigned long long)nstreams, fill_threads(nstreams, 0));
+	}
+	end_section();
+}
+
+/* the parts of out[0..n-1] given to the threads, as in bcn::fill */
+template <class F>
+static void run_parts(size_t n, unsigned int nthreads, F f)
+{
+	size_t work = (n + nthreads - 1) / nthreads;
+
+	default_pool().run(nthreads, [=, &f](unsigned int t)
+	{
+		size_t first = t * work;
+
+		if (first < n)
+			f(first, first + work < n ? work : n - first);
+	});
+}
+
+static void bench_fill(size_t max_n, unsigned int max_threads)
+{
+	double*	x = (double*)aligned_alloc(64, max_n * sizeof(double));
+	double*	y = (double*)aligned_alloc(64, max_n * sizeof(double));
+	float*	f = (float*)aligned_alloc(64, max_n * sizeof(float));
+
+	memset(y, 0, max_n * sizeof(double));
+
+	begin_section("fill");
+	for (size_t n = 1 << 12; n <= max_n; n *= 4)
+	{
+		for (unsigned int threads = 1; threads <= max_threads; threads *= 2)
+		{
+			// fill uses fewer threads for small arrays
+			unsigned int used = fill_threads(n, threads);
+			timing t;
+
+			if (threads > 1 && used < threads)
+				break;
+
+			t = measure(n, [&] { fill(x, n, BENCH_SEED, (lanes_kernel_t<double>)0, threads); check += x[n - 1]; });
+			record(t, sizeof(double), "\"name\": \"fill_double\", \"size\": %zu, \"threads\": %u", n, used);
+
+			t = measure(n, [&] { fill(f, n, BENCH_SEED, (lanes_kernel_t<float>)0, threads); check += f[n - 1]; });
+			record(t, sizeof(float), "\"name\": \"fill_float\", \"size\": %zu, \"threads\": %u", n, used);
+
+			t = measure(n, [&] { fill_combined(x, n, BENCH_SEED, 0, (combined_kernel_t<double>)0, threads); check += x[n - 1]; });
+			record(t, sizeof(double), "\"name\": \"fill_combined\", \"size\": %zu, \"threads\": %u", n, used);
+		}
+	}
+	end_section();
+
+	begin_section("roofline");
+	for (size_t n = 1 << 12; n <= max_n; n *= 4)
+	{
+		for (unsigned int threads = 1; threads <= max_threads; threads *= 2)
+		{
+			unsigned int used = fill_threads(n, threads);
+			timing t;
+
+			if (threads > 1 && used < threads)
+				break;
+
+			t = measure(n, [&]
+			{
+				run_parts(n, used, [&](size_t first, size_t len) { memset(x + first, 0x3F, len * sizeof(double)); });
+				check += x[n - 1];
+			});
+			record(t, sizeof(double), "\"name\": \"memset\", \"size\": %zu, \"threads\": %u", n, used);
+
+			t = measure(n, [&]
+			{
+				run_parts(n, used, [&](size_t first, size_t len) { memcpy(x + first, y + first, len * sizeof(double)); });
+				check += x[n - 1];
+			});
+			record(t, sizeof(double), "\"name\": \"memcpy\", \"size\": %zu, \"threads\": %u", n, used);
+		}
+	}
+	end_section();
+
+	free(x);
+	free(y);
+	free(f);
+}
+
+
+int main(int argc, char **argv)
+{
+	size_t			max_n = 1 << 24;
+	unsigned int	max_threads = default_pool().size();
+
+	if (argc > 3)
+	{
+		printf("Usage ./bcnrand_bench [<largest array size> [<threads>]]\nNow Exiting\n");
+		exit(0);
+	}
+	if (argc > 1)
+		max_n = strtoull(argv[1], 0, 10);
+	if (argc > 2)
+		max_threads = atoi(argv[2]);
+	if (max_n < (1 << 12))
+		max_n = 1 << 12;
+	if (max_threads < 1)
+		max_threads = 1;
+
+	printf("{\n  \"version\": 1, \"isa\": \"%s\", \"generate\": \"%s\", \"pool_threads\": %u, \"max_size\": %zu, \"tsc\": %s",
+		   isa_name(cpu_isa()), default_engine().multistep ? "multistep" : isa_name(default_engine().isa),
+		   default_pool().size(), max_n,
+#if defined(BENCH_HAVE_TSC)
+		   "true"
+#else
+		   "false"
+#endif
+		   );
+
+	bench_steps();
+	bench_seeding();
+	bench_fill(max_n, max_threads);
+
+#ifdef BCN_STATS
+	// the counters of bcnrand_stats.h over the whole run
+	printf(",\n  \"stats\": ");
+	write_stats_json(stdout, snapshot_stats());
+#endif
+	printf(",\n  \"check\": %.6f\n}\n", check);
+	return 0;
+}
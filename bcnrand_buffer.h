@@ -0,0 +1,169 @@
+/* ************************************************************************** */
+/* * bcnrand_buffer.h                                                       * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Buffered front end of the host generator for code that draws one number
+	at a time. The generator keeps a cache aligned buffer of BCN_BUFFER_SIZE
+	variates (16 KB of doubles, half of a typical L1 data cache), refills it
+	with the vector kernels of bcnrand_simd.h, and a draw is a load and an
+	increment of the index.
+
+	The buffer does not change the sequence: the k-th draw is the k-th
+	element, as with bcnrandom_inline, and state() is the state after the
+	draws made so far (computed by skip-ahead from the start of the buffer),
+	so it can be saved and restored with set_state, or advanced by discard.
+
+	A stream that is known to be short (a chunk of bcnrand_sched.h) can be
+	seeded with seed(position, first): the first refill then generates only
+	the first min(first, BCN_BUFFER_SIZE) variates, the following ones the
+	whole buffer.
+
+	A generator must only be used by one thread; local_generator() gives
+	every thread its own one. The class allocates itself on 64 byte
+	boundaries (operator new uses aligned_alloc), because new ignores the
+	alignment of the buffer before C++17 (containers of generators use
+	their allocator and are not covered; keep pointers in them instead).
+
+	Usage:
+			bcn::buffered_generator<> g(seed);	// or bcn::local_generator().seed(seed + 53 * offset)
+			double x = g();						// same as bcnrandom_inline(&state)
+			uint64_t checkpoint = g.state();
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_BUFFER_H
+#define BCNRAND_BUFFER_H
+
+#include <new>
+
+#include "bcnrand_simd.h"
+
+#ifndef BCN_BUFFER_SIZE
+#define BCN_BUFFER_SIZE 2048			/* variates per refill */
+#endif
+
+namespace bcn {
+
+/*
+ * buffered_generator
+ * Draws of the type T (double, float, uint32_t, q32 or the raw uint64_t states, see the
+ * kernels in bcnrand_simd.h) from a buffer refilled with bcn::generate
+ */
+template <class T = double>
+class buffered_generator
+{
+public:
+	typedef T result_type;
+
+	explicit buffered_generator(uint64_t position = 1)
+	{
+		seed(position);
+	}
+
+	/* starts the sequence at the bit position, as Kernel_initGenerator */
+	void seed(uint64_t position)
+	{
+		set_state(BarrettInitBit(position));
+#ifdef BCN_STATS
+		m_variates = 0;
+#endif
+	}
+
+	/* the same, for about first draws: the first refill only generates first variates */
+	void seed(uint64_t position, uint64_t first)
+	{
+		seed(position);
+		if (first && first < BCN_BUFFER_SIZE)
+			m_next = (int)first;
+	}
+
+	/* the next element */
+	T operator()()
+	{
+		if (m_pos == m_len)
+			refill();
+		BCN_STAT_STREAM(m_variates, 1);
+		return m_buf[m_pos++];
+	}
+
+	/* the state after the draws made so far */
+	uint64_t state() const
+	{
+		return m_pos == m_len ? m_end : BarrettSkip(m_start, m_pos);
+	}
+
+	/* continues from the state z (the buffer is refilled at the next draw) */
+	void set_state(uint64_t z)
+	{
+		m_start = m_end = z;
+		m_pos = m_len = 0;
+		m_next = BCN_BUFFER_SIZE;
+	}
+
+	/* skips n elements */
+	void discard(uint64_t n)
+	{
+		if (n < (uint64_t)(m_len - m_pos))
+			m_pos += (int)n;
+		else
+			set_state(BarrettSkip(state(), n));
+	}
+
+	/* the draws since the last seed, with BCN_STATS (bcnrand_stats.h), otherwise 0 */
+	uint64_t variates() const		{ return BCN_STAT_STREAM_COUNT(m_variates); }
+
+	/* aligned heap allocation of m_buf (new only aligns to 16 bytes before C++17) */
+	static void* operator new(size_t size)
+	{
+		void* p = aligned_alloc(64, (size + 63) & ~(size_t)63);
+
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+	static void* operator new[](size_t size)		{ return operator new(size); }
+	static void operator delete(void* p)			{ free(p); }
+	static void operator delete[](void* p)			{ free(p); }
+
+private:
+	void refill()
+	{
+		BCN_STAT_TIMER(refills, refill_ticks);
+
+		m_start = m_end;
+		generate(m_end, m_buf, m_next);
+		m_len = m_next;
+		m_next = BCN_BUFFER_SIZE;
+		m_pos = 0;
+	}
+
+	alignas(64) T	m_buf[BCN_BUFFER_SIZE];
+	uint64_t		m_start;			/* the state before m_buf[0] */
+	uint64_t		m_end;				/* the state after the last element of m_buf */
+	int				m_pos;
+	int				m_len;				/* elements in m_buf */
+	int				m_next;				/* elements of the next refill */
+#ifdef BCN_STATS
+	uint64_t		m_variates;
+#endif
+};
+
+/*
+ * local_generator
+ * The buffered generator of the calling thread, created at the first call. Every thread
+ * must seed its own generator (e.g. with a position depending on the thread).
+ */
+template <class T = double>
+inline buffered_generator<T>& local_generator()
+{
+	static thread_local buffered_generator<T> g;
+	return g;
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_BUFFER_H
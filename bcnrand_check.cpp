@@ -0,0 +1,318 @@
+/* ************************************************************************** */
+/* * bcnrand_check.cpp                                                      * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*
+ * Self-check of the host version: includes every host header and compares the fast paths
+ * with the reference functions of bcnrand_host.h
+ *
+ * Call from the command line:  ./bcnrand_check     (or make check)
+ *
+ *	- the lanes kernels of every instruction set of this CPU (as forced by BCNRAND_ISA),
+ *	  generate_multistep and the combined kernels give the numbers of bcnrandom_inline,
+ *	  randCombined and randCombined53
+ *	- fill, fill_leapfrog, fill_combined and the bulk functions of bcnrand_dist.h and
+ *	  bcnrand_discrete.h give the same output for any number of threads
+ *	- engine::discard is the same as seeding at the later position, and
+ *	  buffered_generator::state() is the state after the draws made so far
+ *	- chunked_reduce gives the same result for any number of threads
+ *	- the birthday spacings test of the battery (t = 2, 2^22 points) fails the bcn
+ *	  generator and passes the combined one
+ *
+ * Prints one line per failed comparison and exits with 1 if there is any.
+ *
+ *	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "bcnrand_host.h"
+#include "bcnrand_stats.h"
+#include "bcnrand_simd.h"
+#include "bcnrand_combined.h"
+#include "bcnrand_pool.h"
+#include "bcnrand_fill.h"
+#include "bcnrand_buffer.h"
+#include "bcnrand_engine.h"
+#include "bcnrand_montecarlo.h"
+#include "bcnrand_sched.h"
+#include "bcnrand_dist.h"
+#include "bcnrand_discrete.h"
+#include "bcnrand_quality.h"
+#include "bcnrand_shm.h"
+
+using namespace bcn;
+
+static int	checks = 0, failures = 0;
+
+#define CHECK(cond, ...)						\
+	do {										\
+		checks++;								\
+		if (!(cond))							\
+		{										\
+			failures++;							\
+			printf("FAIL %s:%d: ", __FILE__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");						\
+		}										\
+	} while (0)
+
+static const uint64_t	POSITION = 112;
+static const size_t		sizes[] = { 0, 1, 7, 8, 9, 31, 64, 100, 1000, 4099 };
+static const unsigned int threads[] = { 1, 2, 3, 7 };
+
+
+/* the lanes kernels, the multistep engine and the combined kernels against the reference */
+static void check_kernels()
+{
+	for (int isa = ISA_SCALAR; isa <= cpu_isa(); isa++)
+	{
+		lanes_kernel_t<double>		kd = get_lanes_kernel<double>((simd_isa)isa);
+		lanes_kernel_t<uint64_t>	kz = get_lanes_kernel<uint64_t>((simd_isa)isa);
+
+		for (size_t n : sizes)
+		{
+			std::vector<double>		x(n + 1), y(n + 1);
+			std::vector<uint64_t>	z(n + 1), w(n + 1);
+			uint64_t	ref = BarrettInitBit(POSITION), sd = ref, sz = ref;
+
+			for (size_t i = 0; i < n; i++)
+			{
+				y[i] = bcnrandom_inline(&ref);
+				w[i] = ref;
+			}
+			generate(sd, x.data(), n, kd);
+			generate(sz, z.data(), n, kz);
+			CHECK(!memcmp(x.data(), y.data(), n * sizeof(double)) && sd == ref,
+				  "generate_%s<double>, n = %zu", isa_name((simd_isa)isa), n);
+			CHECK(!memcmp(z.data(), w.data(), n * sizeof(uint64_t)) && sz == ref,
+				  "generate_%s<uint64_t>, n = %zu", isa_name((simd_isa)isa), n);
+
+			uint64_t	s, s1, r, r1, c, c1;
+
+			seed_combined(POSITION, 0, &s, &s1);
+			r = c = s;
+			r1 = c1 = s1;
+			for (size_t i = 0; i < n; i++)
+				y[i] = randCombined(&r, &r1);
+			generate_combined<31>(c, c1, x.data(), n, get_combined_kernel<double, 31>((simd_isa)isa));
+			CHECK(!memcmp(x.data(), y.data(), n * sizeof(double)) && c == r && c1 == r1,
+				  "generate_combined_%s, n = %zu", isa_name((simd_isa)isa), n);
+
+			r = c = s;
+			r1 = c1 = s1;
+			for (size_t i = 0; i < n; i++)
+				y[i] = randCombined53(&r, &r1);
+			generate_combined<53>(c, c1, x.data(), n, get_combined_kernel<double, 53>((simd_isa)isa));
+			CHECK(!memcmp(x.data(), y.data(), n * sizeof(double)) && c == r && c1 == r1,
+				  "generate_combined53_%s, n = %zu", isa_name((simd_isa)isa), n);
+		}
+	}
+
+	for (size_t n : sizes)
+	{
+		std::vector<double>	x(n + 1), y(n + 1), v(n + 1);
+		uint64_t	ref = BarrettInitBit(POSITION), sm = ref, sg = ref;
+
+		for (size_t i = 0; i < n; i++)
+			y[i] = bcnrandom_inline(&ref);
+		generate_multistep(sm, x.data(), n);
+		generate(sg, v.data(), n);
+		CHECK(!memcmp(x.data(), y.data(), n * sizeof(double)) && sm == ref, "generate_multistep, n = %zu", n);
+		CHECK(!memcmp(v.data(), y.data(), n * sizeof(double)) && sg == ref, "generate (default engine), n = %zu", n);
+	}
+}
+
+/* the bulk functions with any number of threads give the output of one thread */
+static void check_fill()
+{
+	const uint64_t	n = 100003;
+	std::vector<double>	ref(n), x(n), c(n), cx(n);
+	uint64_t	s = BarrettInitBit(POSITION);
+
+	for (uint64_t i = 0; i < n; i++)
+		ref[i] = bcnrandom_inline(&s);
+	fill_combined(c.data(), n, POSITION, 0, (combined_kernel_t<double>)0, 1);
+
+	for (unsigned int t : threads)
+	{
+		fill(x.data(), n, POSITION, (lanes_kernel_t<double>)0, t);
+		CHECK(x == ref, "fill, %u threads", t);
+		fill_leapfrog(x.data(), n, POSITION, (lanes_kernel_t<double>)0, t);
+		CHECK(x == ref, "fill_leapfrog, %u threads", t);
+		fill_combined(cx.data(), n, POSITION, 0, (combined_kernel_t<double>)0, t);
+		CHECK(cx == c, "fill_combined, %u threads", t);
+	}
+}
+
+/* the samplers of bcnrand_dist.h and bcnrand_discrete.h with any number of threads */
+static void check_dist()
+{
+	const uint64_t	n = 10000, words = 200;
+	std::vector<double>		a(n), b(n);
+	std::vector<uint32_t>	i(n), j(n);
+	std::vector<uint64_t>	w(words), v(words);
+
+	fill_normal(a.data(), n, POSITION, 1);
+	fill_bounded(i.data(), n, POSITION, 6, 1);
+	fill_poisson(j.data(), n, POSITION, 3.5, 1);
+	fill_bernoulli(w.data(), words, POSITION, 0.3, 1);
+	for (unsigned int t : threads)
+	{
+		std::vector<uint32_t> k(n);
+
+		fill_normal(b.data(), n, POSITION, t);
+		CHECK(a == b, "fill_normal, %u threads", t);
+		fill_bounded(k.data(), n, POSITION, 6, t);
+		CHECK(k == i, "fill_bounded, %u threads", t);
+		fill_poisson(k.data(), n, POSITION, 3.5, t);
+		CHECK(k == j, "fill_poisson, %u threads", t);
+		fill_bernoulli(v.data(), words, POSITION, 0.3, t);
+		CHECK(v == w, "fill_bernoulli, %u threads", t);
+	}
+
+	// the Bernoulli draws are the test bcnrandom_inline(&seed) < p
+	uint64_t s = BarrettInitBit(POSITION), bad = 0;
+
+	for (uint64_t k = 0; k < 64 * words; k++)
+		bad += (bcnrandom_inline(&s) < 0.3) != (int)((w[k / 64] >> (k % 64)) & 1);
+	CHECK(bad == 0, "fill_bernoulli, %llu draws differ from bcnrandom_inline < p", (unsigned long long)bad);
+
+	// the blocks of a continuing call follow the blocks of the first one
+	fill_normal(a.data(), 4 * BCN_DIST_BLOCK, POSITION, 1);
+	fill_normal(b.data(), BCN_DIST_BLOCK, dist_next_position(3 * BCN_DIST_BLOCK, POSITION), 1);
+	CHECK(!memcmp(b.data(), a.data() + 3 * BCN_DIST_BLOCK, BCN_DIST_BLOCK * sizeof(double)), "dist_next_position");
+}
+
+/* the engines and the buffered generator against fresh seeding */
+static void check_engines()
+{
+	const uint64_t	skips[] = { 0, 1, 7, 1000, 1000000, 123456789012ULL };
+
+	for (uint64_t k : skips)
+	{
+		engine		e(POSITION), f(POSITION + 53 * k);
+
+		e.discard(k);
+		CHECK(e == f && e() == f(), "engine::discard(%llu)", (unsigned long long)k);
+	}
+
+	engine		e(POSITION);
+	std::vector<double> x(5000);
+	uint64_t	s = BarrettInitBit(POSITION);
+
+	e.generate(x.data(), x.data() + x.size());
+	for (size_t i = 0; i < x.size(); i++)
+		CHECK(x[i] == bcnrandom_inline(&s), "engine::generate, element %zu", i);
+	CHECK(e.state() == s, "engine::generate, state");
+
+	combined_engine	c(POSITION), d(POSITION);
+
+	c.discard(1000);
+	for (int i = 0; i < 1000; i++)
+		d();
+	CHECK(c == d && c() == d(), "combined_engine::discard");
+
+	// the state after k draws is the state at the position + 53 k
+	std::unique_ptr<buffered_generator<>>	g(new buffered_generator<>(POSITION));
+	const uint64_t	draws[] = { 0, 1, 100, BCN_BUFFER_SIZE - 1, BCN_BUFFER_SIZE, BCN_BUFFER_SIZE + 1, 5 * BCN_BUFFER_SIZE + 3 };
+
+	CHECK(((uintptr_t)g.get() & 63) == 0, "buffered_generator is not aligned");
+	for (uint64_t k : draws)
+	{
+		uint64_t r = BarrettInitBit(POSITION);
+		bool	 same = true;
+
+		g->seed(POSITION);
+		for (uint64_t i = 0; i < k; i++)
+			same &= (*g)() == bcnrandom_inline(&r);
+		CHECK(same && g->state() == r && g->state() == BarrettInitBit(POSITION + 53 * k),
+			  "buffered_generator::state after %llu draws", (unsigned long long)k);
+
+		g->seed(POSITION, 10);
+		for (uint64_t i = 0; i < k; i++)
+			(*g)();
+		CHECK(g->state() == r, "buffered_generator::seed(position, 10), state after %llu draws", (unsigned long long)k);
+
+		buffered_generator<> h;
+
+		h.set_state(g->state());
+		CHECK(h() == (*g)(), "buffered_generator::set_state after %llu draws", (unsigned long long)k);
+		g->discard(k);
+		h.discard(k);
+		CHECK(g->state() == h.state() && g->state() == BarrettInitBit(POSITION + 53 * (2 * k + 1)),
+			  "buffered_generator::discard(%llu)", (unsigned long long)k);
+	}
+}
+
+/* chunked_reduce and monte_carlo are the same for any number of threads */
+static void check_sched()
+{
+	auto sample = [](uint64_t i, buffered_generator<>& g)
+	{
+		double	sum = 0;
+		int		m = 1 + (int)(i % 97);				// irregular chunks
+
+		for (int k = 0; k < 10 * m; k++)
+			sum += g();
+		return sum;
+	};
+	double	ref = chunked_reduce(1000, 1000, POSITION, sample, std::plus<double>(), 0.0, 1);
+
+	for (unsigned int t : threads)
+	{
+		double r = chunked_reduce(1000, 1000, POSITION, sample, std::plus<double>(), 0.0, t);
+
+		CHECK(r == ref, "chunked_reduce, %u threads: %.17g, %.17g", t, r, ref);
+	}
+
+	// monte_carlo: the count of Kernel_CountValues
+	uint64_t	s = BarrettInitBit(POSITION), count = 0, n = 1000000;
+
+	for (uint64_t i = 0; i < n; i++)
+		count += bcnrandom_inline(&s) < 0.5;
+	CHECK(monte_carlo(n, POSITION, [](double x) { return (uint64_t)(x < 0.5); }, std::plus<uint64_t>()) == count,
+		  "monte_carlo count");
+}
+
+/* one replication of the birthday spacings test of default_tests on the bcn and the combined generator */
+static void check_quality()
+{
+	const test_engine engines[] = { TEST_BCN, TEST_COMBINED };
+
+	for (test_engine e : engines)
+	{
+		std::vector<stat_test*> tests(1, new birthday_test(2, 31, 1 << 22));
+
+		run_tests(tests, e, tests[0]->block_size(), POSITION);
+
+		test_result r = tests[0]->result();
+		bool		failed = r.skipped || r.p_value < 1e-10 || r.p_value > 1 - 1e-10;
+
+		CHECK(failed == (e == TEST_BCN), "%s, %s: %.0f collisions, p-value %g", r.name,
+			  test_engine_name(e), r.statistic, r.p_value);
+		delete_tests(tests);
+	}
+}
+
+int main()
+{
+	printf("bcnrand_check: %s, generate uses %s, %u threads in the pool\n", isa_name(cpu_isa()),
+		   default_engine().multistep ? "multistep" : isa_name(default_engine().isa), default_pool().size());
+
+	check_kernels();
+	check_fill();
+	check_dist();
+	check_engines();
+	check_sched();
+	check_quality();
+
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,444 @@
+/* ************************************************************************** */
+/* * bcnrand_combined.h                                                     * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Vectorised host version of the combined generator randCombined. The
+	kernels advance BCN_LANES pairs of states at once: the bcn state with the
+	modular multiplications of the kernels in bcnrand_simd.h, and the state of
+	the auxiliary lcg 39373 s mod (2^31 + 1) without a division (LCGMod: with
+	x = h 2^31 + l, x = l - h mod 2^31 + 1). The lcg states are kept in the
+	64 bit lanes of the bcn states they are combined with, so the variate
+		rnd = (lcg - bcn) mod 2^31	(0 is returned as 2^31)
+	is formed in the register, without shuffles. The numbers are exactly the
+	same as those of randCombined_increment.
+
+	The 53 bit mode (Bits = 53) gives a double with the full resolution of
+	2^-53 per step of the two generators, instead of 31 bits: the lcg state is
+	aligned with the top of a 53 bit word and the bcn state is subtracted,
+		rnd53 = (lcg 2^22 - bcn) mod 2^53	(0 is returned as 2^53 - 1)
+	the same combination as randCombined_increment, which aligns the lcg with
+	the bottom of a 31 bit word. The top 31 bits mix both generators, the low
+	22 bits are those of -bcn. u = rnd53 2^-53 is exact, it is the variate of
+	randCombined53 (bcnrand_host.h, and bcnrand.h on the GPU). The states are
+	the same as in the 31 bit mode, so seed_combined and skip_combined apply
+	to both.
+
+	Usage:
+			uint64_t s, s1;
+			bcn::seed_combined(seed, 0, &s, &s1);
+			bcn::generate_combined(s, s1, x, n);	// same as n calls of randCombined
+			bcn::generate_combined<53>(s, s1, x, n);	// n calls of randCombined53
+
+		bcn::fill_combined (bcnrand_fill.h) does the same with all cores.
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_COMBINED_H
+#define BCNRAND_COMBINED_H
+
+#include "bcnrand_simd.h"
+
+namespace bcn {
+
+/*
+ * combined_value
+ * rnd of randCombined from the two states after the step, in [1, 2^31],
+ * or rnd53 of randCombined53 in [1, 2^53 - 1]
+ */
+template <int Bits = 31>
+inline uint64_t combined_value(uint64_t z, uint64_t lcg)
+{
+	if (Bits == 53)
+	{
+		uint64_t rnd = ((lcg << 22) - z) & COMB_mask53;
+		return rnd ? rnd : COMB_mask53;
+	}
+
+	uint64_t rnd = (lcg - z) & 0x7FFFFFFFULL;
+	return rnd ? rnd : LCG_m1;
+}
+
+/*
+ * Combined kernel signature. For k = 0..rows-1 the kernel writes
+ *		out[k*stride + j] = combined_value(z[j], l[j]),	j = 0..BCN_LANES-1
+ * converted to the output type T, and then replaces z[j] by z[j] c mod 3^33 and l[j] by
+ * l[j] b mod (2^31 + 1). The output types are
+ *		double		u = rnd / (2^31 + 1), the variate of randCombined
+ *					(u = rnd53 2^-53 in the 53 bit mode)
+ *		float		u rounded to nearest, and to 1 - 2^-24 if it would round to 1
+ *		uint32_t	floor(u 2^32)
+ *		uint64_t	rnd itself (the value of bcn::combined_engine), or rnd53
+ */
+template <class T>
+using combined_kernel_t = void (*)(uint64_t* z, uint64_t* l, T* out, size_t rows, const multiplier& a,
+								   uint64_t b, size_t stride);
+
+template <int Bits = 31>
+inline double combined_double(uint64_t rnd)
+{
+	return Bits == 53 ? rnd * COMB_inv53 : rnd * LCG_m_inv;
+}
+
+template <int Bits = 31>
+inline void store_combined(double* out, uint64_t rnd)	{ *out = combined_double<Bits>(rnd); }
+
+template <int Bits = 31>
+inline void store_combined(uint64_t* out, uint64_t rnd)	{ *out = rnd; }
+
+template <int Bits = 31>
+inline void store_combined(float* out, uint64_t rnd)
+{
+	float f = (float)combined_double<Bits>(rnd);
+	*out = f < BCN_float_max ? f : BCN_float_max;
+}
+
+template <int Bits = 31>
+inline void store_combined(uint32_t* out, uint64_t rnd)
+{
+	*out = Bits == 53 ? (uint32_t)(rnd >> 21) : (uint32_t)(rnd * LCG_m_inv * BCN_2_32);
+}
+
+template <class T, int Bits = 31>
+inline void combined_kernel_scalar(uint64_t* z, uint64_t* l, T* out, size_t rows, const multiplier& a,
+								   uint64_t b, size_t stride)
+{
+	uint64_t	s[BCN_LANES], s1[BCN_LANES];
+	int			j;
+
+	memcpy(s, z, sizeof(s));
+	memcpy(s1, l, sizeof(s1));
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES; j++)
+		{
+			store_combined<Bits>(out + j, combined_value<Bits>(s[j], s1[j]));
+			s[j]  = MulModStep(s[j], a);
+			s1[j] = LCGMod(s1[j] * b);
+		}
+	}
+	memcpy(z, s, sizeof(s));
+	memcpy(l, s1, sizeof(s1));
+}
+
+#if defined(BCN_HAVE_X86_KERNELS)
+
+/* l b mod 2^31 + 1, l <= 2^31 and b < 2^31 + 1 fit the 32 bit multiplication */
+BCN_AVX2 inline __m256i lcgmod_avx2(__m256i l, __m256i b, __m256i mask31, __m256i m)
+{
+	__m256i x = _mm256_mul_epu32(l, b);
+	__m256i r = _mm256_sub_epi64(_mm256_and_si256(x, mask31), _mm256_srli_epi64(x, 31));
+
+	return _mm256_add_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), r), m));
+}
+
+/* rnd in [1, 2^31], or rnd53 in [1, 2^53 - 1] */
+template <int Bits>
+BCN_AVX2 inline __m256i combined_value_avx2(__m256i z, __m256i l)
+{
+	const __m256i	mask = _mm256_set1_epi64x(Bits == 53 ? COMB_mask53 : 0x7FFFFFFFLL);
+	__m256i			rnd, zero;
+
+	rnd  = _mm256_and_si256(_mm256_sub_epi64(Bits == 53 ? _mm256_slli_epi64(l, 22) : l, z), mask);
+	zero = _mm256_cmpeq_epi64(rnd, _mm256_setzero_si256());
+	return _mm256_or_si256(rnd, _mm256_and_si256(zero, Bits == 53 ? mask : _mm256_set1_epi64x(LCG_m1)));
+}
+
+/* rnd < 2^32 is converted with the bits of 2^52, rnd53 from its two halves */
+template <int Bits>
+BCN_AVX2 inline __m256d combined_double_avx2(__m256i rnd)
+{
+	const __m256d magic = _mm256_set1_pd(4503599627370496.0);		/* 2^52 */
+
+	if (Bits == 53)
+		return _mm256_mul_pd(to_exact_double_avx2(rnd, _mm256_set1_epi64x(0xFFFFFFFFLL)), _mm256_set1_pd(COMB_inv53));
+
+	__m256d x = _mm256_castsi256_pd(_mm256_or_si256(rnd, _mm256_castpd_si256(magic)));
+	return _mm256_mul_pd(_mm256_sub_pd(x, magic), _mm256_set1_pd(LCG_m_inv));
+}
+
+template <int Bits>
+BCN_AVX2 inline void store_combined_avx2(double* out, __m256i rnd)
+{
+	_mm256_storeu_pd(out, combined_double_avx2<Bits>(rnd));
+}
+
+template <int Bits>
+BCN_AVX2 inline void store_combined_avx2(uint64_t* out, __m256i rnd)
+{
+	_mm256_storeu_si256((__m256i*)out, rnd);
+}
+
+template <int Bits>
+BCN_AVX2 inline void store_combined_avx2(float* out, __m256i rnd)
+{
+	__m128 f = _mm256_cvtpd_ps(combined_double_avx2<Bits>(rnd));
+	_mm_storeu_ps(out, _mm_min_ps(f, _mm_set1_ps(BCN_float_max)));
+}
+
+/* floor(u 2^32), the top 32 bits of rnd53 */
+template <int Bits>
+BCN_AVX2 inline void store_combined_avx2(uint32_t* out, __m256i rnd)
+{
+	if (Bits == 53)
+	{
+		__m256i x = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(rnd, 21), _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+		_mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(x));
+		return;
+	}
+
+	__m256d x = _mm256_mul_pd(combined_double_avx2<Bits>(rnd), _mm256_set1_pd(BCN_2_32));
+	_mm_storeu_si128((__m128i*)out, to_uint32_avx2(_mm256_floor_pd(x)));
+}
+
+template <class T, int Bits = 31>
+BCN_AVX2 inline void combined_kernel_avx2(uint64_t* z, uint64_t* l, T* out, size_t rows, const multiplier& a,
+										  uint64_t b, size_t stride)
+{
+	const __m256i	mask32 = _mm256_set1_epi64x(0xFFFFFFFFLL), mask31 = _mm256_set1_epi64x(0x7FFFFFFFLL);
+	const __m256i	c  = _mm256_set1_epi64x(a.c),  c_hi  = _mm256_set1_epi64x(a.c >> 32);
+	const __m256i	cs = _mm256_set1_epi64x(a.cs), cs_hi = _mm256_set1_epi64x(a.cs >> 32);
+	const __m256i	m  = _mm256_set1_epi64x(BCN_m), m_hi = _mm256_set1_epi64x(BCN_m >> 32);
+	const __m256i	lb = _mm256_set1_epi64x(b), lm = _mm256_set1_epi64x(LCG_m);
+	__m256i			s[BCN_LANES / 4], s1[BCN_LANES / 4];
+	int				j;
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+	{
+		s[j]  = _mm256_loadu_si256((const __m256i*)(z + 4 * j));
+		s1[j] = _mm256_loadu_si256((const __m256i*)(l + 4 * j));
+	}
+
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES / 4; j++)
+		{
+			store_combined_avx2<Bits>(out + 4 * j, combined_value_avx2<Bits>(s[j], s1[j]));
+			s[j]  = mulmod_avx2(s[j], c, c_hi, cs, cs_hi, m, m_hi, mask32);
+			s1[j] = lcgmod_avx2(s1[j], lb, mask31, lm);
+		}
+	}
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+	{
+		_mm256_storeu_si256((__m256i*)(z + 4 * j), s[j]);
+		_mm256_storeu_si256((__m256i*)(l + 4 * j), s1[j]);
+	}
+}
+
+BCN_AVX512 inline __m512i lcgmod_avx512(__m512i l, __m512i b, __m512i mask31, __m512i m)
+{
+	__m512i x = _mm512_maskz_mul_epu32(BCN_ALL8, l, b);
+	__m512i r = _mm512_sub_epi64(_mm512_and_si512(x, mask31), _mm512_maskz_srli_epi64(BCN_ALL8, x, 31));
+
+	return _mm512_mask_add_epi64(r, _mm512_movepi64_mask(r), r, m);
+}
+
+template <int Bits>
+BCN_AVX512 inline __m512i combined_value_avx512(__m512i z, __m512i l)
+{
+	const __m512i	mask = _mm512_set1_epi64(Bits == 53 ? COMB_mask53 : 0x7FFFFFFFLL);
+	__m512i			rnd;
+
+	rnd = _mm512_and_si512(_mm512_sub_epi64(Bits == 53 ? _mm512_maskz_slli_epi64(BCN_ALL8, l, 22) : l, z), mask);
+	return _mm512_mask_mov_epi64(rnd, _mm512_testn_epi64_mask(rnd, rnd), Bits == 53 ? mask : _mm512_set1_epi64(LCG_m1));
+}
+
+template <int Bits>
+BCN_AVX512 inline __m512d combined_double_avx512(__m512i rnd)
+{
+	return _mm512_mul_pd(_mm512_cvtepu64_pd(rnd), _mm512_set1_pd(Bits == 53 ? COMB_inv53 : LCG_m_inv));
+}
+
+template <int Bits>
+BCN_AVX512 inline void store_combined_avx512(double* out, __m512i rnd)
+{
+	_mm512_storeu_pd(out, combined_double_avx512<Bits>(rnd));
+}
+
+template <int Bits>
+BCN_AVX512 inline void store_combined_avx512(uint64_t* out, __m512i rnd)
+{
+	_mm512_storeu_si512(out, rnd);
+}
+
+template <int Bits>
+BCN_AVX512 inline void store_combined_avx512(float* out, __m512i rnd)
+{
+	__m256 f = _mm512_maskz_cvtpd_ps(BCN_ALL8, combined_double_avx512<Bits>(rnd));
+	_mm256_storeu_ps(out, _mm256_min_ps(f, _mm256_set1_ps(BCN_float_max)));
+}
+
+template <int Bits>
+BCN_AVX512 inline void store_combined_avx512(uint32_t* out, __m512i rnd)
+{
+	if (Bits == 53)
+	{
+		_mm256_storeu_si256((__m256i*)out, _mm512_maskz_cvtepi64_epi32(BCN_ALL8, _mm512_maskz_srli_epi64(BCN_ALL8, rnd, 21)));
+		return;
+	}
+
+	__m512d x = _mm512_mul_pd(combined_double_avx512<Bits>(rnd), _mm512_set1_pd(BCN_2_32));
+	_mm256_storeu_si256((__m256i*)out, _mm512_maskz_cvttpd_epu32(BCN_ALL8, x));
+}
+
+template <class T, int Bits = 31>
+BCN_AVX512 inline void combined_kernel_avx512ifma(uint64_t* z, uint64_t* l, T* out, size_t rows, const multiplier& a,
+												  uint64_t b, size_t stride)
+{
+	const __m512i	c   = _mm512_set1_epi64(a.c);
+	const __m512i	c52 = _mm512_set1_epi64(a.c52);
+	const __m512i	m   = _mm512_set1_epi64(BCN_m);
+	const __m512i	bit52 = _mm512_set1_epi64(1LL << 52);
+	const __m512i	lb = _mm512_set1_epi64(b), lm = _mm512_set1_epi64(LCG_m);
+	const __m512i	mask31 = _mm512_set1_epi64(0x7FFFFFFFLL);
+	__m512i			s[BCN_LANES / 8], s1[BCN_LANES / 8];
+	int				j;
+
+	for (j = 0; j < BCN_LANES / 8; j++)
+	{
+		s[j]  = _mm512_loadu_si512(z + 8 * j);
+		s1[j] = _mm512_loadu_si512(l + 8 * j);
+	}
+
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES / 8; j++)
+		{
+			store_combined_avx512<Bits>(out + 8 * j, combined_value_avx512<Bits>(s[j], s1[j]));
+			s[j]  = mulmod_avx512ifma(s[j], c, c52, m, bit52);
+			s1[j] = lcgmod_avx512(s1[j], lb, mask31, lm);
+		}
+	}
+
+	for (j = 0; j < BCN_LANES / 8; j++)
+	{
+		_mm512_storeu_si512(z + 8 * j, s[j]);
+		_mm512_storeu_si512(l + 8 * j, s1[j]);
+	}
+}
+
+#endif // BCN_HAVE_X86_KERNELS
+
+/* the combined kernel of the instruction set (the FMA CPUs use the AVX2 one) */
+template <class T, int Bits = 31>
+inline combined_kernel_t<T> get_combined_kernel(simd_isa isa)
+{
+#if defined(BCN_HAVE_X86_KERNELS)
+	if (isa == ISA_AVX512IFMA)
+		return combined_kernel_avx512ifma<T, Bits>;
+	if (isa >= ISA_AVX2)
+		return combined_kernel_avx2<T, Bits>;
+#endif
+	return combined_kernel_scalar<T, Bits>;
+}
+
+/*
+ * combined_step
+ * Step policy of run_stream (bcnrand_kernel.h) for randCombined (randCombined53 with Bits = 53),
+ * the host counterpart of combined_step in bcnrand.h
+ */
+template <int Bits = 31>
+struct combined_step
+{
+	typedef uint64_t result_type;
+
+	uint64_t	z, z1;
+
+	combined_step(uint64_t s, uint64_t s1) : z(s), z1(s1) {}
+
+	uint64_t next()
+	{
+		z = barrett_step_opt(z);
+		return combined_value<Bits>(z, randlcgSimple_increment(&z1));
+	}
+
+	template <int U>
+	void next_block(uint64_t* r)
+	{
+		for (int j = 0; j < U; j++)
+			r[j] = next();
+	}
+
+	double variate(uint64_t r) const { return combined_double<Bits>(r); }
+
+	template <class T>
+	void store(T* p, uint64_t r) const { store_combined<Bits>(p, r); }
+};
+
+/*
+ * combined_leapfrog
+ * The multipliers of BCN_LANES steps of the two generators, 2^(53 BCN_LANES) mod 3^33
+ * and 39373^BCN_LANES mod (2^31 + 1)
+ */
+struct combined_leapfrog
+{
+	multiplier	bcn;
+	uint64_t	lcg;
+};
+
+inline combined_leapfrog make_combined_leapfrog()
+{
+	combined_leapfrog p;
+
+	p.bcn = make_multiplier(pow2_53(BCN_LANES));
+	p.lcg = LCGSkip(1, BCN_LANES);
+	return p;
+}
+
+/*
+ * generate_combined
+ * Writes the next n variates of the combined generator to out and advances both states by
+ * n steps, the result is the same as out[i] = randCombined(&s, &s1), i = 0..n-1 (for double),
+ * or randCombined53 for Bits = 53.
+ * kernel: one of the combined kernels above (of the same Bits), 0 for the best one for this CPU
+ */
+template <int Bits = 31, class T>
+inline void generate_combined(uint64_t& s, uint64_t& s1, T* out, size_t n, combined_kernel_t<T> kernel = 0)
+{
+	static const combined_leapfrog		step = make_combined_leapfrog();
+	static const combined_kernel_t<T>	best = get_combined_kernel<T, Bits>(cpu_isa());
+	uint64_t	z[BCN_LANES], l[BCN_LANES];
+	size_t		rows, i;
+	int			j;
+
+	if (Bits == 53)
+		BCN_STAT_ADD(variates_combined53, n);
+	else
+		BCN_STAT_ADD(variates_combined, n);
+
+	if (n < 2 * BCN_LANES)
+	{
+		combined_step<Bits>	c(s, s1);
+		strided_output<T>	o = make_strided_output(out, 1);
+
+		run_stream<8>(c, o, n);
+		s  = c.z;
+		s1 = c.z1;
+		return;
+	}
+
+	for (j = 0; j < BCN_LANES; j++)
+	{
+		z[j] = s = barrett_step_opt(s);
+		l[j] = randlcgSimple_increment(&s1);
+	}
+
+	// keep at least one row for the tail, the last states are read from it
+	rows = (n - 1) / BCN_LANES;
+	(kernel ? kernel : best)(z, l, out, rows, step.bcn, step.lcg, BCN_LANES);
+
+	out += rows * BCN_LANES;
+	n   -= rows * BCN_LANES;
+	for (i = 0; i < n; i++)
+		store_combined<Bits>(out + i, combined_value<Bits>(z[i], l[i]));
+	s  = z[n - 1];
+	s1 = l[n - 1];
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_COMBINED_H
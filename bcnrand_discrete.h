@@ -0,0 +1,409 @@
+/* ************************************************************************** */
+/* * bcnrand_discrete.h                                                     * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Discrete distributions computed from the integer states z of the bcn
+	generator, without the conversion to double: z is uniform on the
+	3^33 - 1 values 1, ..., 3^33 - 1.
+
+	Bernoulli(p):	z <= T, with T the largest state with z 3^-33 < p in
+					double precision, so the draws are exactly those of the test
+					bcnrandom_inline(&seed) < p of Kernel_CountValues, with the
+					probability T / (3^33 - 1) (about p 3^33 / (3^33 - 1)).
+					fill_bernoulli packs 64 draws per word.
+	[0, n):			Lemire's multiply and reject method, on the range 3^33 - 1
+					instead of a power of 2: x = z - 1, the result is
+					floor(x n / (3^33 - 1)), and x is rejected if
+					x n mod (3^33 - 1) < (3^33 - 1) mod n. Unbiased.
+	Poisson, binomial:	inversion of the cumulative distribution, stored
+					as integer thresholds on z with a guide table (one state per
+					variate, a few comparisons on average). The table covers the
+					mean +- 12 standard deviations, so its size grows as the
+					square root of the mean; the probabilities are exact to
+					1 / (3^33 - 1).
+
+	The draws that use one state each (Bernoulli, Poisson, binomial) are
+	position based as in fill: the element i is computed from the state at
+	the position + 53 i. Bounded integers use the blocks of bcnrand_dist.h.
+	The output never depends on the number of threads.
+
+	Usage:
+			bcn::fill_bernoulli(bits, nwords, seed, 0.3);	// 64 nwords flips
+			bcn::fill_bounded(x, n, seed, 6);			// dice, 0..5
+			bcn::fill_poisson(x, n, seed, 3.5);
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_DISCRETE_H
+#define BCNRAND_DISCRETE_H
+
+#include <cmath>
+#include <vector>
+
+#include "bcnrand_dist.h"
+
+namespace bcn {
+
+static const uint64_t	BCN_states = BCN_m - 1;						/* number of different states, 3^33 - 1 */
+static const double		BCN_states_inv = 1.7988650924514303747e-16;	/* 1.0 / (double)(BCN_states) */
+
+
+/* ============================== Bernoulli ============================== */
+
+/*
+ * bernoulli_threshold
+ * The threshold T of Bernoulli(p) draws z <= T, 0 <= p <= 1: the largest state with
+ * to_double(z) < p (0 if there is none). ceil(p 3^33) - 1 is within a few states of it, the
+ * rounding of the products is corrected by comparing to_double of the neighbours, which is
+ * monotone in z.
+ */
+inline uint64_t bernoulli_threshold(double p)
+{
+	int64_t		T;
+
+	if (p <= 0)
+		return 0;
+	if (p > 1)
+		return BCN_states;
+
+	T = (int64_t)ceil(p * (double)BCN_m) - 1;
+	if (T < 0)
+		T = 0;
+	if (T > (int64_t)BCN_states)
+		T = (int64_t)BCN_states;
+	while (T > 0 && to_double((uint64_t)T) >= p)
+		T--;
+	while (T < (int64_t)BCN_states && to_double((uint64_t)T + 1) < p)
+		T++;
+	return (uint64_t)T;
+}
+
+/*
+ * bernoulli_bits
+ * Packs the draws z[i] <= T of 64 nwords states into nwords words, bit b of the word w is the
+ * draw 64 w + b. The vector versions make 4 (AVX2) or 8 (AVX-512) bits per comparison.
+ */
+inline void bernoulli_bits_scalar(const uint64_t* z, uint64_t T, uint64_t* words, size_t nwords)
+{
+	for (size_t w = 0; w < nwords; w++, z += 64)
+	{
+		uint64_t bits = 0;
+
+		for (int b = 0; b < 64; b++)
+			bits |= (uint64_t)(z[b] <= T) << b;
+		words[w] = bits;
+	}
+}
+
+#if defined(BCN_HAVE_X86_KERNELS)
+
+BCN_AVX2 inline void bernoulli_bits_avx2(const uint64_t* z, uint64_t T, uint64_t* words, size_t nwords)
+{
+	// z, T < 2^63, so the signed comparison z > T is safe
+	const __m256i t = _mm256_set1_epi64x(T);
+
+	for (size_t w = 0; w < nwords; w++, z += 64)
+	{
+		uint64_t bits = 0;
+
+		for (int b = 0; b < 64; b += 4)
+		{
+			__m256i gt = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i*)(z + b)), t);
+			bits |= (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(gt)) & 0xF) << b;
+		}
+		words[w] = bits;
+	}
+}
+
+BCN_AVX512 inline void bernoulli_bits_avx512(const uint64_t* z, uint64_t T, uint64_t* words, size_t nwords)
+{
+	const __m512i t = _mm512_set1_epi64(T);
+
+	for (size_t w = 0; w < nwords; w++, z += 64)
+	{
+		uint64_t bits = 0;
+
+		for (int b = 0; b < 64; b += 8)
+			bits |= (uint64_t)_mm512_cmple_epu64_mask(_mm512_loadu_si512(z + b), t) << b;
+		words[w] = bits;
+	}
+}
+
+#endif // BCN_HAVE_X86_KERNELS
+
+inline void bernoulli_bits(const uint64_t* z, uint64_t T, uint64_t* words, size_t nwords)
+{
+#if defined(BCN_HAVE_X86_KERNELS)
+	if (cpu_isa() == ISA_AVX512IFMA)
+		return bernoulli_bits_avx512(z, T, words, nwords);
+	if (cpu_isa() >= ISA_AVX2)
+		return bernoulli_bits_avx2(z, T, words, nwords);
+#endif
+	bernoulli_bits_scalar(z, T, words, nwords);
+}
+
+/*
+ * fill_bernoulli
+ * Writes 64 nwords Bernoulli(p) draws of the sequence starting at position, packed 64 per word
+ * (the draw i is the bit i % 64 of words[i / 64]), in parallel
+ * Parameters:
+ *	words:		output, nwords words
+ *	nwords:		input, number of words
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ *	p:			input, probability of 1
+ *	nthreads:	input, number of threads, 0 for the size of the default pool (does not change the output)
+ */
+inline void fill_bernoulli(uint64_t* words, uint64_t nwords, uint64_t position, double p, unsigned int nthreads = 0)
+{
+	const uint64_t T = bernoulli_threshold(p);
+
+	for_each_chunk(64 * nwords, position, nthreads, [=](uint64_t first, const uint64_t* z, size_t len)
+	{
+		bernoulli_bits(z, T, words + first / 64, len / 64);
+	});
+}
+
+
+/* ============================== bounded integers ============================== */
+
+/*
+ * bounded_threshold
+ * (3^33 - 1) mod n, the states x n mod (3^33 - 1) below it are rejected
+ */
+inline uint64_t bounded_threshold(uint32_t n)
+{
+	return BCN_states % n;
+}
+
+/*
+ * bounded_step
+ * Maps the state z to *r = floor((z - 1) n / (3^33 - 1)) in [0, n), returns false if z is rejected.
+ * The quotient is estimated in double precision (error < 1) and corrected with the exact remainder.
+ */
+inline bool bounded_step(uint64_t z, uint32_t n, uint64_t threshold, uint32_t* r)
+{
+	uint64_t	x = z - 1;
+	uint64_t	q = (uint64_t)((double)(int64_t)x * (double)n * BCN_states_inv);
+	int64_t		rem = (int64_t)(x * n - q * BCN_states);
+
+	if (rem < 0)
+	{
+		q--;
+		rem += BCN_states;
+	}
+	else if (rem >= (int64_t)BCN_states)
+	{
+		q++;
+		rem -= BCN_states;
+	}
+	*r = (uint32_t)q;
+	return (uint64_t)rem >= threshold;
+}
+
+/*
+ * bounded
+ * One unbiased integer in [0, n) from the stream, n > 0
+ */
+inline uint32_t bounded(state_stream& s, uint32_t n)
+{
+	uint64_t	threshold = bounded_threshold(n);
+	uint32_t	r;
+
+	while (!bounded_step(s.next(), n, threshold, &r))
+		;
+	return r;
+}
+
+/*
+ * bounded_block
+ * Writes len integers in [0, n) to out, the same values as len calls of bounded(s, n).
+ * The states of the buffer are mapped and the accepted ones are compacted without branches.
+ */
+inline void bounded_block(state_stream& s, uint32_t* out, size_t len, uint32_t n, uint64_t threshold)
+{
+	size_t	k = 0;
+	int		j, end;
+
+	while (k < len)
+	{
+		end = s.fill();
+
+		const uint64_t* z = s.data();
+		for (j = s.pos(); j < end && k < len; j++)
+			k += bounded_step(z[j], n, threshold, out + k);
+		s.consume(j - s.pos());
+	}
+}
+
+/*
+ * fill_bounded
+ * Writes to out n unbiased integers in [0, bound), bound > 0, in parallel,
+ * the other parameters are as in fill_bernoulli. Returns the number of blocks that overran
+ * BCN_DIST_STRIDE, as fill_normal; the next call starts at dist_next_position(n, position).
+ */
+inline uint64_t fill_bounded(uint32_t* out, uint64_t n, uint64_t position, uint32_t bound, unsigned int nthreads = 0)
+{
+	const uint64_t threshold = bounded_threshold(bound);
+
+	return fill_blocks(out, n, position, nthreads, [=](state_stream& s, uint32_t* x, size_t len)
+	{
+		bounded_block(s, x, len, bound, threshold);
+	});
+}
+
+
+/* ============================== inversion tables ============================== */
+
+/*
+ * discrete_table
+ * Inversion of a discrete distribution on offset, offset + 1, ...: the state z gives
+ * offset + k for the smallest k with z <= cdf[k]. guide[g] is the smallest k with
+ * cdf[k] >= g 2^shift, the first candidate for the states z >> shift = g.
+ */
+class discrete_table
+{
+public:
+	uint64_t operator()(uint64_t z) const
+	{
+		uint32_t k = m_guide[z >> m_shift];
+
+		while (z > m_cdf[k])
+			k++;
+		return m_offset + k;
+	}
+
+	/* one variate from the stream */
+	uint64_t operator()(state_stream& s) const
+	{
+		return (*this)(s.next());
+	}
+
+protected:
+	discrete_table() : m_offset(0), m_shift(53) {}
+
+	/* the table for the probabilities proportional to pmf[k] of offset + k */
+	void build(const std::vector<double>& pmf, uint64_t offset)
+	{
+		double		total = 0, c = 0;
+		size_t		k, size = pmf.size(), g;
+		uint64_t	guides = 1;
+
+		for (k = 0; k < size; k++)
+			total += pmf[k];
+
+		m_offset = offset;
+		m_cdf.resize(size);
+		for (k = 0; k < size; k++)
+		{
+			c += pmf[k];
+			m_cdf[k] = (uint64_t)llround(c / total * (double)BCN_states);
+		}
+		m_cdf[size - 1] = BCN_states;
+
+		m_shift = 53;
+		while (guides < size)
+		{
+			guides <<= 1;
+			m_shift--;
+		}
+		m_guide.resize(guides);
+		for (g = 0, k = 0; g < guides; g++)
+		{
+			while (k < size - 1 && m_cdf[k] < ((uint64_t)g << m_shift))
+				k++;
+			m_guide[g] = (uint32_t)k;
+		}
+	}
+
+	std::vector<uint64_t>	m_cdf;
+	std::vector<uint32_t>	m_guide;
+	uint64_t				m_offset;
+	int						m_shift;
+};
+
+/*
+ * poisson_table
+ * Poisson(mean), mean >= 0
+ */
+class poisson_table : public discrete_table
+{
+public:
+	explicit poisson_table(double mean)
+	{
+		std::vector<double>	pmf;
+		double		w = ceil(12 * sqrt(mean) + 24), mode = floor(mean);
+		uint64_t	lo = mode > w ? (uint64_t)(mode - w) : 0, hi = (uint64_t)(mode + w), k;
+
+		if (mean <= 0)
+			hi = 0;
+		for (k = lo; k <= hi; k++)
+			pmf.push_back(mean <= 0 ? 1 : exp(k * log(mean) - mean - lgamma(k + 1.0)));
+		build(pmf, lo);
+	}
+};
+
+/*
+ * binomial_table
+ * Binomial(n, p), 0 <= p <= 1
+ */
+class binomial_table : public discrete_table
+{
+public:
+	binomial_table(uint64_t n, double p)
+	{
+		std::vector<double>	pmf;
+		double		w = ceil(12 * sqrt(n * p * (1 - p)) + 24), mode = floor((n + 1) * p);
+		uint64_t	lo = mode > w ? (uint64_t)(mode - w) : 0, hi = (uint64_t)(mode + w), k;
+
+		if (hi > n)
+			hi = n;
+		if (p <= 0 || p >= 1)
+		{
+			lo = hi = p <= 0 ? 0 : n;
+			pmf.push_back(1);
+		}
+		else
+		{
+			for (k = lo; k <= hi; k++)
+				pmf.push_back(exp(lgamma(n + 1.0) - lgamma(k + 1.0) - lgamma(n - k + 1.0)
+								  + k * log(p) + (n - k) * log1p(-p)));
+		}
+		build(pmf, lo);
+	}
+};
+
+/*
+ * fill_table
+ * Writes to out n variates of the table, the element i from the state at the position + 53 i
+ */
+inline void fill_table(uint32_t* out, uint64_t n, uint64_t position, const discrete_table& table, unsigned int nthreads = 0)
+{
+	for_each_chunk(n, position, nthreads, [&table, out](uint64_t first, const uint64_t* z, size_t len)
+	{
+		for (size_t i = 0; i < len; i++)
+			out[first + i] = (uint32_t)table(z[i]);
+	});
+}
+
+/*
+ * fill_poisson, fill_binomial
+ * Write to out n Poisson(mean) or Binomial(trials, p) variates (below 2^32), the other
+ * parameters are as in fill_bernoulli
+ */
+inline void fill_poisson(uint32_t* out, uint64_t n, uint64_t position, double mean, unsigned int nthreads = 0)
+{
+	fill_table(out, n, position, poisson_table(mean), nthreads);
+}
+
+inline void fill_binomial(uint32_t* out, uint64_t n, uint64_t position, uint64_t trials, double p, unsigned int nthreads = 0)
+{
+	fill_table(out, n, position, binomial_table(trials, p), nthreads);
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_DISCRETE_H
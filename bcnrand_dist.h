@@ -0,0 +1,605 @@
+/* ************************************************************************** */
+/* * bcnrand_dist.h                                                         * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Non-uniform distributions on top of the host bcn generator: normal and
+	exponential (ziggurat method of Marsaglia and Tsang, in the form of
+	Doornik's ZIGNOR), gamma (Marsaglia and Tsang) and log-normal.
+
+	The samplers read the raw states z of the sequence (z in [1, 3^33)),
+	which are generated in blocks by the vector kernels of bcnrand_simd.h.
+	The fast path of the ziggurat (about 99% of the draws) is computed for
+	the whole buffer of states without branches, 8 (AVX-512) or 4 (AVX2)
+	draws at a time with gathers from the tables, selected by cpu_isa() as
+	the kernels of bcnrand_simd.h; only the rejected draws are completed one
+	by one. A draw uses u = z 3^-33 (or (2z - 3^33) 3^-33) as the uniform and
+	the low bits of z as the layer.
+
+	The bulk functions split the output into blocks of BCN_DIST_BLOCK
+	variates. The block b reads the sequence from the position
+		position + 53 BCN_DIST_STRIDE b,
+	in the same way as Kernel_initGenerator gives each thread its own part of
+	the sequence, so the output only depends on the position and not on the
+	number of threads. The samplers use a random number of states per
+	variate: a block of normals or exponentials needs about 1.03
+	BCN_DIST_BLOCK states, bounded integers (bcnrand_discrete.h) at most
+	2 BCN_DIST_BLOCK on average, and gamma about 2.1 BCN_DIST_BLOCK for
+	shape >= 1 and up to 3.2 BCN_DIST_BLOCK for shape < 1. BCN_DIST_STRIDE
+	= 8 BCN_DIST_BLOCK is far above all of them. The bulk functions count
+	the states every block consumes, and return the number of blocks that
+	needed more than BCN_DIST_STRIDE (their last values are then the first
+	ones of the next block); it is 0 unless the sequence is extraordinarily
+	unlucky.
+
+	So n variates occupy 53 BCN_DIST_STRIDE ceil(n / BCN_DIST_BLOCK) bit
+	positions of the sequence, not 53 n: a call that continues the output
+	of another one must start at dist_next_position(n, position), otherwise
+	it repeats its blocks.
+
+	The tables and the rejection tests use exp and log, so the results are
+	reproducible on the same platform; on other platforms they can differ in
+	the last bits if the math library does.
+
+	Usage:
+			bcn::fill_normal(x, n, seed);				// N(0,1)
+			bcn::fill_exponential(x, n, seed);			// Exp(1)
+			bcn::fill_gamma(x, n, seed, shape);			// Gamma(shape, 1)
+			bcn::fill_lognormal(x, n, seed, mu, sigma);
+			seed = bcn::dist_next_position(n, seed);	// for the next call
+
+		or one at a time,
+			bcn::state_stream s(seed);
+			double x = bcn::normal(s);
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_DIST_H
+#define BCNRAND_DIST_H
+
+#include <atomic>
+#include <cmath>
+
+#include "bcnrand_fill.h"
+
+namespace bcn {
+
+static const uint64_t	BCN_DIST_BLOCK  = 1024;					/* variates per block of the bulk functions */
+static const uint64_t	BCN_DIST_STRIDE = 8 * BCN_DIST_BLOCK;	/* states of the sequence per block */
+static const int		BCN_STREAM_BUFFER = 512;				/* states generated at once by state_stream */
+
+/*
+ * state_stream
+ * The raw states of the sequence starting at a position, in the order of bcnrandom_inline,
+ * generated BCN_STREAM_BUFFER at a time. data() and pos() give access to the current
+ * buffer, generation() changes every time the buffer is refilled, consumed() is the number
+ * of states taken so far.
+ */
+class state_stream
+{
+public:
+	explicit state_stream(uint64_t position)
+		: m_state(BarrettInitBit(position)), m_pos(BCN_STREAM_BUFFER), m_generation(0)
+	{
+	}
+
+	/* the next state, z in [1, 3^33) */
+	uint64_t next()
+	{
+		if (m_pos == BCN_STREAM_BUFFER)
+			refill();
+		return m_buf[m_pos++];
+	}
+
+	/* the next uniform variate on (0,1) */
+	double uniform()
+	{
+		return to_double(next());
+	}
+
+	/* makes sure that the buffer is not empty, returns the number of states in it */
+	int fill()
+	{
+		if (m_pos == BCN_STREAM_BUFFER)
+			refill();
+		return BCN_STREAM_BUFFER;
+	}
+
+	/* skips count states of the buffer, count <= BCN_STREAM_BUFFER - pos() */
+	void consume(int count)
+	{
+		m_pos += count;
+	}
+
+	const uint64_t*	data() const		{ return m_buf; }
+	int				pos() const			{ return m_pos; }
+	unsigned long	generation() const	{ return m_generation; }
+
+	uint64_t consumed() const
+	{
+		return m_generation ? (uint64_t)(m_generation - 1) * BCN_STREAM_BUFFER + m_pos : 0;
+	}
+
+private:
+	void refill()
+	{
+		generate(m_state, m_buf, BCN_STREAM_BUFFER);
+		m_pos = 0;
+		m_generation++;
+	}
+
+	uint64_t		m_buf[BCN_STREAM_BUFFER];
+	uint64_t		m_state;
+	int				m_pos;
+	unsigned long	m_generation;
+};
+
+
+/* ============================== ziggurat ============================== */
+
+/*
+ * ziggurat
+ * The layers of the ziggurat for the density f: x[i] is the right edge of the layer i
+ * (x[0] = v / f(r) for the base layer with the tail, x[1] = r, x[C] = 0), ratio[i] = x[i+1] / x[i]
+ * is the part of the layer inside the density, fx[i] = f(x[i]).
+ */
+template <int C>
+struct ziggurat
+{
+	double	x[C + 1];
+	double	ratio[C];
+	double	fx[C + 1];
+};
+
+/* normal, 128 layers: f(x) = exp(-x^2/2), r = 3.442619855899, v = 9.91256303526217e-3 */
+static const int	BCN_ZIG_NORMAL = 128;
+static const double	BCN_ZIG_NORMAL_R = 3.442619855899;
+
+inline ziggurat<BCN_ZIG_NORMAL> make_normal_ziggurat()
+{
+	const double	r = BCN_ZIG_NORMAL_R, v = 9.91256303526217e-3;
+	ziggurat<BCN_ZIG_NORMAL>	t;
+	int			i;
+
+	t.x[0] = v / exp(-0.5 * r * r);
+	t.x[1] = r;
+	t.x[BCN_ZIG_NORMAL] = 0;
+	for (i = 2; i < BCN_ZIG_NORMAL; i++)
+		t.x[i] = sqrt(-2 * log(v / t.x[i - 1] + exp(-0.5 * t.x[i - 1] * t.x[i - 1])));
+	for (i = 0; i < BCN_ZIG_NORMAL; i++)
+		t.ratio[i] = t.x[i + 1] / t.x[i];
+	for (i = 0; i <= BCN_ZIG_NORMAL; i++)
+		t.fx[i] = exp(-0.5 * t.x[i] * t.x[i]);
+	return t;
+}
+
+/* exponential, 256 layers: f(x) = exp(-x), r = 7.69711747013104972, v = 3.949659822581572e-3 */
+static const int	BCN_ZIG_EXP = 256;
+static const double	BCN_ZIG_EXP_R = 7.69711747013104972;
+
+inline ziggurat<BCN_ZIG_EXP> make_exp_ziggurat()
+{
+	const double	r = BCN_ZIG_EXP_R, v = 3.949659822581572e-3;
+	ziggurat<BCN_ZIG_EXP>	t;
+	int			i;
+
+	t.x[0] = v / exp(-r);
+	t.x[1] = r;
+	t.x[BCN_ZIG_EXP] = 0;
+	for (i = 2; i < BCN_ZIG_EXP; i++)
+		t.x[i] = -log(v / t.x[i - 1] + exp(-t.x[i - 1]));
+	for (i = 0; i < BCN_ZIG_EXP; i++)
+		t.ratio[i] = t.x[i + 1] / t.x[i];
+	for (i = 0; i <= BCN_ZIG_EXP; i++)
+		t.fx[i] = exp(-t.x[i]);
+	return t;
+}
+
+inline const ziggurat<BCN_ZIG_NORMAL>& normal_ziggurat()
+{
+	static const ziggurat<BCN_ZIG_NORMAL> t = make_normal_ziggurat();
+	return t;
+}
+
+inline const ziggurat<BCN_ZIG_EXP>& exp_ziggurat()
+{
+	static const ziggurat<BCN_ZIG_EXP> t = make_exp_ziggurat();
+	return t;
+}
+
+/*
+ * normal_slow, exp_slow
+ * The rest of a draw that failed the fast test |u| < ratio[i]: the tail for the base layer,
+ * otherwise the test under the density in the wedge. Return false if the draw is rejected,
+ * the extra uniforms are read from s.
+ */
+inline bool normal_slow(state_stream& s, double u, int i, double* x)
+{
+	const ziggurat<BCN_ZIG_NORMAL>& t = normal_ziggurat();
+	double	a, y;
+
+	if (i == 0)
+	{
+		do
+		{
+			a = log(s.uniform()) / BCN_ZIG_NORMAL_R;
+			y = log(s.uniform());
+		} while (-2 * y < a * a);
+		*x = u < 0 ? a - BCN_ZIG_NORMAL_R : BCN_ZIG_NORMAL_R - a;
+		return true;
+	}
+
+	*x = u * t.x[i];
+	return t.fx[i + 1] + s.uniform() * (t.fx[i] - t.fx[i + 1]) < exp(-0.5 * *x * *x);
+}
+
+inline bool exp_slow(state_stream& s, double u, int i, double* x)
+{
+	const ziggurat<BCN_ZIG_EXP>& t = exp_ziggurat();
+
+	if (i == 0)
+	{
+		*x = BCN_ZIG_EXP_R - log(s.uniform());
+		return true;
+	}
+
+	*x = u * t.x[i];
+	return t.fx[i + 1] + s.uniform() * (t.fx[i] - t.fx[i + 1]) < exp(-*x);
+}
+
+/* the uniform and the layer of a draw; 2 z - m is exact, so u has one rounding */
+inline double normal_u(uint64_t z)	{ return BCN_minv * (double)(2 * (int64_t)z - (int64_t)BCN_m); }
+inline int normal_layer(uint64_t z)	{ return (int)(z & (BCN_ZIG_NORMAL - 1)); }
+inline double exp_u(uint64_t z)		{ return BCN_minv * (double)(int64_t)z; }
+inline int exp_layer(uint64_t z)	{ return (int)(z & (BCN_ZIG_EXP - 1)); }
+
+/*
+ * normal, exponential
+ * One N(0,1) or Exp(1) variate from the stream
+ */
+inline double normal(state_stream& s)
+{
+	const ziggurat<BCN_ZIG_NORMAL>& t = normal_ziggurat();
+	double	u, x;
+	int		i;
+
+	for (;;)
+	{
+		uint64_t z = s.next();
+
+		u = normal_u(z);
+		i = normal_layer(z);
+		if (fabs(u) < t.ratio[i])
+			return u * t.x[i];
+		if (normal_slow(s, u, i, &x))
+			return x;
+	}
+}
+
+inline double exponential(state_stream& s)
+{
+	const ziggurat<BCN_ZIG_EXP>& t = exp_ziggurat();
+	double	u, x;
+	int		i;
+
+	for (;;)
+	{
+		uint64_t z = s.next();
+
+		u = exp_u(z);
+		i = exp_layer(z);
+		if (u < t.ratio[i])
+			return u * t.x[i];
+		if (exp_slow(s, u, i, &x))
+			return x;
+	}
+}
+
+/*
+ * ziggurat_fast
+ * The fast path of the draws z[j], j = begin..end-1: xs[j] = u t.x[i], and fast[j] = 1 if the
+ * draw is accepted by |u| < t.ratio[i]. The vector versions compute 4 (AVX2) or 8 (AVX-512)
+ * draws at a time with gathers from the table, with the same roundings as the scalar one: the
+ * states are below 2^53, so their conversion to double is exact.
+ */
+template <int C, bool Normal>
+inline void ziggurat_fast_scalar(const ziggurat<C>& t, const uint64_t* z, double* xs, unsigned char* fast,
+								 int begin, int end)
+{
+	double	u;
+	int		i, j;
+
+	for (j = begin; j < end; j++)
+	{
+		i = (int)(z[j] & (C - 1));
+		u = Normal ? normal_u(z[j]) : exp_u(z[j]);
+		xs[j] = u * t.x[i];
+		fast[j] = (Normal ? fabs(u) : u) < t.ratio[i];
+	}
+}
+
+#if defined(BCN_HAVE_X86_KERNELS)
+
+/* z < 2^53 to double: the two 32 bit halves are converted with the 2^52 exponent trick */
+BCN_AVX2 inline __m256d state_to_double_avx2(__m256i z)
+{
+	const __m256i	magic = _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d	two52 = _mm256_set1_pd(4503599627370496.0);
+	const __m256i	mask32 = _mm256_set1_epi64x(0xFFFFFFFFLL);
+	__m256d			lo, hi;
+
+	lo = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(z, mask32), magic)), two52);
+	hi = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(z, 32), magic)), two52);
+	return _mm256_add_pd(_mm256_mul_pd(hi, _mm256_set1_pd(4294967296.0)), lo);
+}
+
+template <int C, bool Normal>
+BCN_AVX2 inline void ziggurat_fast_avx2(const ziggurat<C>& t, const uint64_t* z, double* xs, unsigned char* fast,
+										int begin, int end)
+{
+	const __m256i	layer = _mm256_set1_epi64x(C - 1);
+	const __m256d	minv = _mm256_set1_pd(BCN_minv);
+	const __m256d	m = _mm256_set1_pd((double)BCN_m);
+	const __m256d	sign = _mm256_set1_pd(-0.0);
+	__m256i			zj, i;
+	__m256d			d, u;
+	int				j, bits;
+
+	for (j = begin; j + 4 <= end; j += 4)
+	{
+		zj = _mm256_loadu_si256((const __m256i*)(z + j));
+		i = _mm256_and_si256(zj, layer);
+		d = state_to_double_avx2(zj);
+		// 2 d - m and d are exact integers below 2^53, u has one rounding as normal_u, exp_u
+		u = _mm256_mul_pd(Normal ? _mm256_sub_pd(_mm256_add_pd(d, d), m) : d, minv);
+		_mm256_storeu_pd(xs + j, _mm256_mul_pd(u, _mm256_i64gather_pd(t.x, i, 8)));
+		bits = _mm256_movemask_pd(_mm256_cmp_pd(Normal ? _mm256_andnot_pd(sign, u) : u,
+												_mm256_i64gather_pd(t.ratio, i, 8), _CMP_LT_OQ));
+		fast[j] = bits & 1;
+		fast[j + 1] = (bits >> 1) & 1;
+		fast[j + 2] = (bits >> 2) & 1;
+		fast[j + 3] = (bits >> 3) & 1;
+	}
+	ziggurat_fast_scalar<C, Normal>(t, z, xs, fast, j, end);
+}
+
+template <int C, bool Normal>
+BCN_AVX512 inline void ziggurat_fast_avx512(const ziggurat<C>& t, const uint64_t* z, double* xs, unsigned char* fast,
+											int begin, int end)
+{
+	const __m512i	layer = _mm512_set1_epi64(C - 1);
+	const __m512i	one = _mm512_set1_epi64(1);
+	const __m512d	minv = _mm512_set1_pd(BCN_minv);
+	const __m512d	m = _mm512_set1_pd((double)BCN_m);
+	const __m512d	zero = _mm512_setzero_pd();
+	__m512i			zj, i;
+	__m512d			d, u;
+	__mmask8		k;
+	int				j;
+
+	for (j = begin; j + 8 <= end; j += 8)
+	{
+		zj = _mm512_loadu_si512(z + j);
+		i = _mm512_and_si512(zj, layer);
+		d = _mm512_cvtepi64_pd(zj);
+		u = _mm512_mul_pd(Normal ? _mm512_sub_pd(_mm512_add_pd(d, d), m) : d, minv);
+		_mm512_storeu_pd(xs + j, _mm512_mul_pd(u, _mm512_mask_i64gather_pd(zero, (__mmask8)0xFF, i, t.x, 8)));
+		k = _mm512_cmp_pd_mask(Normal ? _mm512_abs_pd(u) : u, _mm512_mask_i64gather_pd(zero, (__mmask8)0xFF, i, t.ratio, 8), _CMP_LT_OQ);
+		_mm_storel_epi64((__m128i*)(fast + j), _mm512_mask_cvtepi64_epi8(_mm_setzero_si128(), (__mmask8)0xFF, _mm512_maskz_mov_epi64(k, one)));
+	}
+	ziggurat_fast_scalar<C, Normal>(t, z, xs, fast, j, end);
+}
+
+#endif // BCN_HAVE_X86_KERNELS
+
+template <int C, bool Normal>
+inline void ziggurat_fast(const ziggurat<C>& t, const uint64_t* z, double* xs, unsigned char* fast, int begin, int end)
+{
+#if defined(BCN_HAVE_X86_KERNELS)
+	if (cpu_isa() == ISA_AVX512IFMA)
+		return ziggurat_fast_avx512<C, Normal>(t, z, xs, fast, begin, end);
+	if (cpu_isa() >= ISA_AVX2)
+		return ziggurat_fast_avx2<C, Normal>(t, z, xs, fast, begin, end);
+#endif
+	ziggurat_fast_scalar<C, Normal>(t, z, xs, fast, begin, end);
+}
+
+/*
+ * ziggurat_block
+ * Writes n variates to out, the same values as n calls of normal(s) (exponential(s)).
+ * The fast path is computed for all the states in the buffer of s (ziggurat_fast), then the
+ * states are taken in order as in the scalar sampler. Since a rejected draw reads its extra
+ * uniforms from the same buffer, the precomputed values stay valid until the buffer is
+ * refilled.
+ */
+template <int C, bool Normal>
+inline void ziggurat_block(const ziggurat<C>& t, state_stream& s, double* out, size_t n)
+{
+	double			xs[BCN_STREAM_BUFFER];
+	unsigned char	fast[BCN_STREAM_BUFFER];
+	size_t			k = 0;
+	double			u, x;
+	int				j, i, len;
+
+	while (k < n)
+	{
+		len = s.fill();
+
+		const uint64_t*		z = s.data();
+		const unsigned long	g = s.generation();
+
+		ziggurat_fast<C, Normal>(t, z, xs, fast, s.pos(), len);
+
+		for (j = s.pos(); k < n && j < len; )
+		{
+			if (fast[j])
+			{
+				out[k++] = xs[j++];
+				continue;
+			}
+			s.consume(j + 1 - s.pos());
+			i = (int)(z[j] & (C - 1));
+			u = Normal ? normal_u(z[j]) : exp_u(z[j]);
+			if (Normal ? normal_slow(s, u, i, &x) : exp_slow(s, u, i, &x))
+				out[k++] = x;
+			if (s.generation() != g)
+				break;
+			j = s.pos();
+		}
+		if (s.generation() == g)
+			s.consume(j - s.pos());
+	}
+}
+
+inline void normal_block(state_stream& s, double* out, size_t n)
+{
+	ziggurat_block<BCN_ZIG_NORMAL, true>(normal_ziggurat(), s, out, n);
+}
+
+inline void exponential_block(state_stream& s, double* out, size_t n)
+{
+	ziggurat_block<BCN_ZIG_EXP, false>(exp_ziggurat(), s, out, n);
+}
+
+/*
+ * gamma
+ * One Gamma(shape, 1) variate from the stream, shape > 0 (Marsaglia and Tsang). For shape < 1
+ * a Gamma(shape + 1) variate is multiplied by u^(1/shape).
+ */
+inline double gamma(state_stream& s, double shape)
+{
+	double	d, c, x, v, u;
+
+	if (shape < 1)
+	{
+		x = gamma(s, shape + 1);
+		return x * pow(s.uniform(), 1.0 / shape);
+	}
+
+	d = shape - 1.0 / 3;
+	c = 1 / sqrt(9 * d);
+	for (;;)
+	{
+		do
+		{
+			x = normal(s);
+			v = 1 + c * x;
+		} while (v <= 0);
+
+		v = v * v * v;
+		u = s.uniform();
+		if (u < 1 - 0.0331 * (x * x) * (x * x))
+			return d * v;
+		if (log(u) < 0.5 * x * x + d * (1 - v + log(v)))
+			return d * v;
+	}
+}
+
+
+/* ============================== bulk functions ============================== */
+
+/*
+ * dist_next_position
+ * The position after n variates of the bulk functions started at position, i.e. the position
+ * of the block following the last one: position + 53 BCN_DIST_STRIDE ceil(n / BCN_DIST_BLOCK)
+ */
+inline uint64_t dist_next_position(uint64_t n, uint64_t position)
+{
+	return position + 53 * BCN_DIST_STRIDE * ((n + BCN_DIST_BLOCK - 1) / BCN_DIST_BLOCK);
+}
+
+/*
+ * fill_blocks
+ * Calls block(s, out + b BCN_DIST_BLOCK, length) for every block b of the output in parallel,
+ * s is the stream at the position + 53 BCN_DIST_STRIDE b. Returns the number of blocks that
+ * consumed more than BCN_DIST_STRIDE states, i.e. overlap with the next block.
+ */
+template <class T, class Block>
+inline uint64_t fill_blocks(T* out, uint64_t n, uint64_t position, unsigned int nthreads, Block block)
+{
+	uint64_t	nblocks = (n + BCN_DIST_BLOCK - 1) / BCN_DIST_BLOCK;
+	uint64_t	work;
+	std::atomic<uint64_t>	overruns(0);
+
+	nthreads = fill_threads(n, nthreads);
+
+	work = (nblocks + nthreads - 1) / nthreads;
+
+	default_pool().run(nthreads, [=, &block, &overruns](unsigned int t)
+	{
+		uint64_t	over = 0;
+
+		for (uint64_t b = t * work; b < nblocks && b < (t + 1) * work; b++)
+		{
+			uint64_t	first = b * BCN_DIST_BLOCK;
+			state_stream s(position + 53 * BCN_DIST_STRIDE * b);
+
+			block(s, out + first, (size_t)(first + BCN_DIST_BLOCK < n ? BCN_DIST_BLOCK : n - first));
+			over += s.consumed() > BCN_DIST_STRIDE;
+		}
+		if (over)
+			overruns.fetch_add(over, std::memory_order_relaxed);
+	});
+	return overruns.load();
+}
+
+/*
+ * fill_normal
+ * Writes to out n N(0,1) variates of the sequence starting at position, in parallel
+ * Parameters:
+ *	out:		output, n doubles
+ *	n:			input, number of variates
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ *	nthreads:	input, number of threads, 0 for the size of the default pool (does not change the output)
+ * Returns the number of blocks that overran BCN_DIST_STRIDE (0 in practice). The next variates of
+ * the sequence start at dist_next_position(n, position), not at position + 53 n.
+ */
+inline uint64_t fill_normal(double* out, uint64_t n, uint64_t position, unsigned int nthreads = 0)
+{
+	return fill_blocks(out, n, position, nthreads, normal_block);
+}
+
+/*
+ * fill_exponential
+ * Writes to out n Exp(1) variates, the parameters are as in fill_normal
+ */
+inline uint64_t fill_exponential(double* out, uint64_t n, uint64_t position, unsigned int nthreads = 0)
+{
+	return fill_blocks(out, n, position, nthreads, exponential_block);
+}
+
+/*
+ * fill_gamma
+ * Writes to out n Gamma(shape, scale) variates, shape > 0, the other parameters are as in fill_normal
+ */
+inline uint64_t fill_gamma(double* out, uint64_t n, uint64_t position, double shape, double scale = 1.0,
+						   unsigned int nthreads = 0)
+{
+	return fill_blocks(out, n, position, nthreads, [=](state_stream& s, double* x, size_t len)
+	{
+		for (size_t i = 0; i < len; i++)
+			x[i] = scale * gamma(s, shape);
+	});
+}
+
+/*
+ * fill_lognormal
+ * Writes to out n variates exp(mu + sigma N(0,1)), with the same normals as fill_normal
+ */
+inline uint64_t fill_lognormal(double* out, uint64_t n, uint64_t position, double mu, double sigma,
+							   unsigned int nthreads = 0)
+{
+	return fill_blocks(out, n, position, nthreads, [=](state_stream& s, double* x, size_t len)
+	{
+		normal_block(s, x, len);
+		for (size_t i = 0; i < len; i++)
+			x[i] = exp(mu + sigma * x[i]);
+	});
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_DIST_H
@@ -0,0 +1,275 @@
+/* ************************************************************************** */
+/* * bcnrand_engine.h                                                       * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	The host generators as C++ random number engines: bcn::engine and
+	bcn::combined_engine satisfy the requirements RandomNumberEngine (and so
+	UniformRandomBitGenerator) of the standard library, and can be used with
+	the distributions of <random>.
+
+	bcn::engine returns the states z of the bcn generator, uniform on
+	[1, 3^33 - 1]; z 3^-33 is the variate of bcnrandom_inline.
+	bcn::combined_engine returns the integers rnd of randCombined, uniform on
+	[1, 2^31]; rnd 2^-31 is the variate of randCombined.
+
+	seed(position) starts the sequence at the bit position, as
+	Kernel_initGenerator (Kernel_initGeneratorCombined) does. discard(n) is an
+	O(log n) skip-ahead. The bulk member generate(first, last) writes the next
+	last - first elements of the sequence in the format of the element type,
+	as bcn::generate does (double, float, uint32_t, q32 or the raw uint64_t
+	states); for pointers it uses the vector kernels (for combined_engine,
+	those of bcnrand_combined.h for double and uint64_t).
+
+	Usage:
+			bcn::engine e(seed);
+			std::normal_distribution<double> normal;
+			double x = normal(e);
+			e.discard(1000000000000);
+			e.generate(v, v + n);				// double* v, same as n calls of bcnrandom_inline
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_ENGINE_H
+#define BCNRAND_ENGINE_H
+
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+
+#include "bcnrand_combined.h"
+
+namespace bcn {
+
+static const uint64_t BCN_DEFAULT_POSITION = 1;		/* the seed of the engines created without one */
+
+/*
+ * engine
+ * The bcn generator, z_k+1 = 2^53 z_k mod 3^33
+ */
+class engine
+{
+public:
+	typedef uint64_t result_type;
+
+	static const result_type default_seed = BCN_DEFAULT_POSITION;
+
+	engine() { seed(); }
+	explicit engine(result_type position) { seed(position); }
+
+	template <class Sseq, class = typename std::enable_if<!std::is_convertible<Sseq, result_type>::value
+														 && !std::is_same<Sseq, engine>::value>::type>
+	explicit engine(Sseq& q) { seed(q); }
+
+	static constexpr result_type min() { return 1; }
+	static constexpr result_type max() { return BCN_m - 1; }
+
+	/* starts the sequence at the bit position */
+	void seed(result_type position = default_seed)
+	{
+		m_state = BarrettInitBit(position);
+#ifdef BCN_STATS
+		m_variates = 0;
+#endif
+	}
+
+	/* the position is made of two 32 bit words of the seed sequence */
+	template <class Sseq>
+	typename std::enable_if<!std::is_convertible<Sseq, result_type>::value>::type seed(Sseq& q)
+	{
+		uint32_t w[2];
+
+		q.generate(w, w + 2);
+		seed(((uint64_t)w[1] << 32) | w[0]);
+	}
+
+	result_type operator()()
+	{
+		BCN_STAT_ADD(variates_bcn, 1);
+		BCN_STAT_STREAM(m_variates, 1);
+		return next(m_state);
+	}
+
+	void discard(unsigned long long n)
+	{
+		skip(m_state, n);
+	}
+
+	/* writes the next elements in the format of T (see the kernels in bcnrand_simd.h) */
+	template <class T>
+	void generate(T* first, T* last)
+	{
+		BCN_STAT_STREAM(m_variates, last - first);
+		bcn::generate(m_state, first, (size_t)(last - first));
+	}
+
+	template <class It>
+	void generate(It first, It last)
+	{
+		for (; first != last; ++first)
+		{
+			BCN_STAT_ADD(variates_bcn, 1);
+			BCN_STAT_STREAM(m_variates, 1);
+			store_state(&*first, next(m_state));
+		}
+	}
+
+	/* the current state, the engine can be restored with set_state */
+	uint64_t state() const			{ return m_state; }
+	void set_state(uint64_t state)	{ m_state = state; }
+
+	/* the variates drawn since the last seed, with BCN_STATS (bcnrand_stats.h), otherwise 0 */
+	uint64_t variates() const		{ return BCN_STAT_STREAM_COUNT(m_variates); }
+
+	friend bool operator==(const engine& a, const engine& b) { return a.m_state == b.m_state; }
+	friend bool operator!=(const engine& a, const engine& b) { return a.m_state != b.m_state; }
+
+	template <class CharT, class Traits>
+	friend std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const engine& e)
+	{
+		return os << e.m_state;
+	}
+
+	template <class CharT, class Traits>
+	friend std::basic_istream<CharT, Traits>& operator>>(std::basic_istream<CharT, Traits>& is, engine& e)
+	{
+		uint64_t state;
+
+		if (is >> state)
+			e.m_state = state;
+		return is;
+	}
+
+private:
+	uint64_t	m_state;
+#ifdef BCN_STATS
+	uint64_t	m_variates;
+#endif
+};
+
+/*
+ * combined_engine
+ * The combined generator of randCombined, the bcn generator minus the lcg 39373 s mod (2^31 + 1)
+ */
+class combined_engine
+{
+public:
+	typedef uint32_t result_type;
+
+	static const uint64_t default_seed = BCN_DEFAULT_POSITION;
+
+	combined_engine() { seed(); }
+	explicit combined_engine(uint64_t position) { seed(position); }
+
+	template <class Sseq, class = typename std::enable_if<!std::is_convertible<Sseq, uint64_t>::value
+														 && !std::is_same<Sseq, combined_engine>::value>::type>
+	explicit combined_engine(Sseq& q) { seed(q); }
+
+	static constexpr result_type min() { return 1; }
+	static constexpr result_type max() { return (result_type)LCG_m1; }
+
+	/* starts both generators as Kernel_initGeneratorCombined for the element at the position */
+	void seed(uint64_t position = default_seed)
+	{
+		seed_combined(position, 0, &m_state, &m_lcg);
+#ifdef BCN_STATS
+		m_variates = 0;
+#endif
+	}
+
+	template <class Sseq>
+	typename std::enable_if<!std::is_convertible<Sseq, uint64_t>::value>::type seed(Sseq& q)
+	{
+		uint32_t w[2];
+
+		q.generate(w, w + 2);
+		seed(((uint64_t)w[1] << 32) | w[0]);
+	}
+
+	/* rnd of randCombined, 0 is returned as 2^31 */
+	result_type operator()()
+	{
+		uint64_t rnd = randCombined_increment(&m_state, &m_lcg);
+
+		BCN_STAT_ADD(variates_combined, 1);
+		BCN_STAT_STREAM(m_variates, 1);
+		return (result_type)(rnd ? rnd : LCG_m1);
+	}
+
+	void discard(unsigned long long n)
+	{
+		skip_combined(m_state, m_lcg, n);
+	}
+
+	/* the variates of randCombined, or their rnd, with the vector kernels of bcnrand_combined.h */
+	void generate(double* first, double* last)
+	{
+		BCN_STAT_STREAM(m_variates, last - first);
+		generate_combined(m_state, m_lcg, first, (size_t)(last - first));
+	}
+
+	void generate(uint64_t* first, uint64_t* last)
+	{
+		BCN_STAT_STREAM(m_variates, last - first);
+		generate_combined(m_state, m_lcg, first, (size_t)(last - first));
+	}
+
+	/* writes the next variates of randCombined (for T = double) or their rnd */
+	template <class It>
+	void generate(It first, It last)
+	{
+		typedef typename std::iterator_traits<It>::value_type T;
+
+		for (; first != last; ++first)
+			*first = std::is_floating_point<T>::value ? (T)((*this)() * LCG_m_inv) : (T)(*this)();
+	}
+
+	/* the variates drawn since the last seed, as engine::variates */
+	uint64_t variates() const		{ return BCN_STAT_STREAM_COUNT(m_variates); }
+
+	friend bool operator==(const combined_engine& a, const combined_engine& b)
+	{
+		return a.m_state == b.m_state && a.m_lcg == b.m_lcg;
+	}
+
+	friend bool operator!=(const combined_engine& a, const combined_engine& b)
+	{
+		return !(a == b);
+	}
+
+	template <class CharT, class Traits>
+	friend std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const combined_engine& e)
+	{
+		CharT space = os.widen(' ');
+
+		return os << e.m_state << space << e.m_lcg;
+	}
+
+	template <class CharT, class Traits>
+	friend std::basic_istream<CharT, Traits>& operator>>(std::basic_istream<CharT, Traits>& is, combined_engine& e)
+	{
+		uint64_t state, lcg;
+
+		if (is >> state >> lcg)
+		{
+			e.m_state = state;
+			e.m_lcg = lcg;
+		}
+		return is;
+	}
+
+private:
+	uint64_t	m_state;
+	uint64_t	m_lcg;
+#ifdef BCN_STATS
+	uint64_t	m_variates;
+#endif
+};
+
+} // namespace bcn
+
+#endif // BCNRAND_ENGINE_H
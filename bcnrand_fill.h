@@ -0,0 +1,267 @@
+/* ************************************************************************** */
+/* * bcnrand_fill.h                                                         * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Multithreaded bulk generation on the host. The sequence is partitioned
+	between the threads as in Kernel_initGenerator: every thread computes a
+	contiguous part of the output and starts from the seed BarrettInitBit at
+	the position of its first element. Since every element only depends on
+	its position in the sequence, the output is the same for any number of
+	threads (and the same as on the GPU).
+
+	Positions are bit positions as in Kernel_initGenerator: the element i of
+	the sequence that starts at position p is at the position p + 53 i.
+
+	Usage:
+			bcn::fill(x, n, seed);			// x[i] = element i starting at seed
+			bcn::fill(f, n, seed);			// the same variates as float (float* f)
+			bcn::fill(x, n, seed, bcn::kernel_scalar, 16);
+
+	build_seed_array computes the seeds of many streams at once: the seed of
+	stream t is the state of the first stream advanced by t stride steps,
+	i.e. a geometric progression with the ratio 2^(53 stride) mod 3^33. Only
+	one BarrettInitBit per thread is needed, the rest is one modular
+	multiplication per seed in the vector kernels. The seeds of Kernel_Opt are
+			bcn::build_seed_array(seeds, numBlocks * numThreadsPerBlock, seed, workPerThread);
+	the same as d_SeedData of Kernel_initGenerator.
+
+	fill_combined does the same for the combined generator (bcnrand_combined.h),
+	partitioned as in Kernel_initGeneratorCombined.
+
+	fill_leapfrog gives the same output as fill, but the sequence is split
+	between the threads by leapfrogging instead of contiguous blocks: with T
+	threads, the lane j of the thread t (worker g = t BCN_LANES + j of
+	W = T BCN_LANES) produces the positions g, g + W, g + 2W, ... using the
+	multiplier 2^(53 W) mod 3^33. Each row of W consecutive elements is
+	written by the team at once, every thread storing one contiguous tile of
+	BCN_LANES elements (whole cache lines when out is 64 byte aligned).
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_FILL_H
+#define BCNRAND_FILL_H
+
+#include "bcnrand_combined.h"
+#include "bcnrand_pool.h"
+
+namespace bcn {
+
+static const uint64_t BCN_FILL_MIN = 1 << 16;	/* smallest part of the output given to a thread */
+
+/*
+ * fill_threads
+ * The number of threads for n elements: nthreads (0 for the size of the default pool),
+ * but no more than one per BCN_FILL_MIN elements
+ */
+inline unsigned int fill_threads(uint64_t n, unsigned int nthreads)
+{
+	if (nthreads == 0)
+		nthreads = default_pool().size();
+	if (nthreads > (n + BCN_FILL_MIN - 1) / BCN_FILL_MIN)
+		nthreads = (unsigned int)((n + BCN_FILL_MIN - 1) / BCN_FILL_MIN);
+	return nthreads ? nthreads : 1;
+}
+
+/*
+ * fill
+ * Writes to out the n random variates of the sequence starting at position, in parallel
+ * Parameters:
+ *	out:		output, n variates in one of the formats of bcnrand_simd.h (double, float, uint32_t,
+ *				q32, or uint64_t for the raw states)
+ *	n:			input, number of random variates
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ *	engine:		input, the kernel used by each thread, 0 for the best one for this CPU
+ *	nthreads:	input, number of parts of the sequence, 0 for the size of the default pool
+ */
+template <class T>
+inline void fill(T* out, uint64_t n, uint64_t position, lanes_kernel_t<T> engine = 0, unsigned int nthreads = 0)
+{
+	uint64_t	work;
+
+	BCN_STAT_TIMER(fills, fill_ticks);
+	BCN_STAT_ADD(fill_bytes, n * sizeof(T));
+
+	nthreads = fill_threads(n, nthreads);
+
+	// workPerThread, rounded to whole cache lines
+	work = (n + nthreads - 1) / nthreads;
+	work = (work + 7) & ~(uint64_t)7;
+
+	default_pool().run(nthreads, [=](unsigned int t)
+	{
+		uint64_t first = t * work;
+
+		if (first >= n)
+			return;
+
+		uint64_t seed = BarrettInitBit(position + 53 * first);
+		generate(seed, out + first, (size_t)(first + work < n ? work : n - first), engine);
+	});
+}
+
+/*
+ * fill_combined
+ * Writes to out the elements first, ..., first + n - 1 of the combined generator (randCombined)
+ * whose element i is seeded as in Kernel_initGeneratorCombined (seed_combined(position, i)),
+ * in parallel and with the same result for any number of threads
+ * Parameters:
+ *	out:		output, n variates in one of the formats of bcnrand_combined.h (double, float,
+ *				uint32_t, or uint64_t for the integers rnd)
+ *	n:			input, number of random variates
+ *	position:	input, starting position (the seed of Kernel_initGeneratorCombined)
+ *	first:		input, index of the first element
+ *	engine:		input, the combined kernel used by each thread, 0 for the best one for this CPU
+ *	nthreads:	input, number of parts of the sequence, 0 for the size of the default pool
+ * fill_combined<53> writes the variates of randCombined53 instead.
+ */
+template <int Bits = 31, class T>
+inline void fill_combined(T* out, uint64_t n, uint64_t position, uint64_t first = 0,
+						  combined_kernel_t<T> engine = 0, unsigned int nthreads = 0)
+{
+	uint64_t	work;
+
+	BCN_STAT_TIMER(fills, fill_ticks);
+	BCN_STAT_ADD(fill_bytes, n * sizeof(T));
+
+	nthreads = fill_threads(n, nthreads);
+
+	work = (n + nthreads - 1) / nthreads;
+	work = (work + 7) & ~(uint64_t)7;
+
+	default_pool().run(nthreads, [=](unsigned int t)
+	{
+		uint64_t i = t * work, s, s1;
+
+		if (i >= n)
+			return;
+
+		seed_combined(position, first + i, &s, &s1);
+		generate_combined<Bits>(s, s1, out + i, (size_t)(i + work < n ? work : n - i), engine);
+	});
+}
+
+/*
+ * for_each_chunk
+ * Calls f(first, z, len) in parallel for the raw states z[0..len-1] of the elements first,
+ * ..., first + len - 1 of the sequence starting at position, for all n elements; first is a
+ * multiple of BCN_FILL_CHUNK and len <= BCN_FILL_CHUNK. The states are partitioned between
+ * the threads as in fill, so f sees the same states for any number of threads.
+ */
+static const int BCN_FILL_CHUNK = 1024;
+
+template <class F>
+inline void for_each_chunk(uint64_t n, uint64_t position, unsigned int nthreads, F f)
+{
+	uint64_t	work;
+
+	nthreads = fill_threads(n, nthreads);
+	work = (n + nthreads - 1) / nthreads;
+	work = (work + BCN_FILL_CHUNK - 1) / BCN_FILL_CHUNK * BCN_FILL_CHUNK;
+
+	default_pool().run(nthreads, [=, &f](unsigned int t)
+	{
+		uint64_t	z[BCN_FILL_CHUNK];
+		uint64_t	first = t * work, last = first + work < n ? first + work : n;
+
+		if (first >= n)
+			return;
+
+		uint64_t seed = BarrettInitBit(position + 53 * first);
+		for (; first < last; first += BCN_FILL_CHUNK)
+		{
+			size_t len = (size_t)(last - first < (uint64_t)BCN_FILL_CHUNK ? last - first : BCN_FILL_CHUNK);
+
+			generate(seed, z, len);
+			f(first, (const uint64_t*)z, len);
+		}
+	});
+}
+
+/*
+ * fill_leapfrog
+ * Writes to out the n random variates of the sequence starting at position, in parallel,
+ * the threads fill interleaved tiles of each row of the output (see above).
+ * The parameters and the result are the same as in fill.
+ */
+template <class T>
+inline void fill_leapfrog(T* out, uint64_t n, uint64_t position, lanes_kernel_t<T> engine = 0, unsigned int nthreads = 0)
+{
+	uint64_t	width, rows;
+
+	BCN_STAT_TIMER(fills, fill_ticks);
+	BCN_STAT_ADD(fill_bytes, n * sizeof(T));
+
+	nthreads = fill_threads(n, nthreads);
+
+	width = (uint64_t)nthreads * BCN_LANES;
+	rows  = n / width;
+
+	const multiplier leap = make_multiplier(pow2_53(width));
+
+	default_pool().run(nthreads, [=, &leap](unsigned int t)
+	{
+		uint64_t	z[BCN_LANES];
+		uint64_t	first = (uint64_t)t * BCN_LANES, i;
+		int			j;
+
+		// the lane j starts at the element first + j of the sequence
+		z[0] = barrett_step_opt(BarrettInitBit(position + 53 * first));
+		for (j = 1; j < BCN_LANES; j++)
+			z[j] = barrett_step_opt(z[j - 1]);
+
+		if (engine)
+			engine(z, out + first, (size_t)rows, leap, (size_t)width);
+		else
+			lanes_generate(z, out + first, (size_t)rows, leap, (size_t)width);
+
+		// the last partial row
+		for (j = 0, i = rows * width + first; j < BCN_LANES && i < n; j++, i++)
+			store_state(out + i, z[j]);
+		BCN_STAT_ADD(variates_bcn, rows * BCN_LANES + j);
+	});
+}
+
+/*
+ * build_seed_array
+ * Writes to out the seeds of nstreams streams, stream t starts at the position + 53 stride t:
+ *		out[t] = BarrettInitBit(position + 53 * stride * t)	(when it fits in 64 bits)
+ * Parameters:
+ *	out:		output, nstreams states
+ *	nstreams:	input, number of streams
+ *	position:	input, starting position of the stream 0
+ *	stride:		input, number of elements between the starts of two consecutive streams
+ *	nthreads:	input, number of parts of the array, 0 for the size of the default pool
+ */
+inline void build_seed_array(uint64_t* out, uint64_t nstreams, uint64_t position, uint64_t stride,
+							 unsigned int nthreads = 0)
+{
+	uint64_t	work;
+
+	nthreads = fill_threads(nstreams, nthreads);
+
+	work = (nstreams + nthreads - 1) / nthreads;
+	work = (work + 7) & ~(uint64_t)7;
+
+	const uint64_t	seed0 = BarrettInitBit(position);
+	const leapfrog	ratio = make_leapfrog(pow2_53(stride));
+
+	default_pool().run(nthreads, [=, &ratio](unsigned int t)
+	{
+		uint64_t first = t * work;
+
+		if (first >= nstreams)
+			return;
+
+		// stride * first can exceed 64 bits, the skip is taken modulo the period
+		uint64_t anchor = BarrettSkip(seed0, (uint64_t)((uint128_t)stride * first % BCN_period));
+		progression(anchor, ratio, out + first, (size_t)(first + work < nstreams ? work : nstreams - first));
+	});
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_FILL_H
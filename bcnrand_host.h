@@ -0,0 +1,150 @@
+/* ************************************************************************** */
+/* * bcnrand_host.h                                                         * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	This is the host (CPU) version of the library bcnrand. It generates the
+	same sequence of uniform random variates on (0,1) as the CUDA version in
+	bcnrand.h, element by element, so a computation can be moved between the
+	GPU and the CPU without changing its results.
+
+	The implementation is header only and does not need CUDA. It uses the
+	native 128 bit integer type of gcc/clang (unsigned __int128), so the
+	Barrett reduction costs two multiplications (mulx with -mbmi2) and has
+	no loop.
+
+	Everything is in the namespace bcn. The low level functions have the same
+	names and arguments as their device versions in bcnrand.inl:
+		barrett_step_opt, barrett_step_simple, BarrettStep, LCN_Inline,
+		BarrettInitBit, BarrettSkip,
+		LCGMod, LCGStep, LCGInitBit, LCGSkip, seedCombined, skipCombined,
+		randlcgSimple_increment, randCombined_increment, randCombined53_increment
+
+	Usage:
+			uint64_t state = bcn::BarrettInitBit(seed);	// seed = starting position
+			for (i = 0 ; i < n ; i++)
+				x[i] = bcn::bcnrandom_inline(&state);
+
+		or, for the combined generator,
+			uint64_t s, s1;
+			bcn::seedCombined(seed, seed, &s, &s1);
+			for (i = 0 ; i < n ; i++)
+				x[i] = bcn::randCombined(&s, &s1);
+
+		The i-th thread of Kernel_initGenerator gets the same state as
+			bcn::BarrettInitBit(seed + 53 * (i * workPerThread))
+		and bcn::skip(state, n) jumps n elements ahead from any state.
+
+	The seeding tables are computed at compile time; BCN_SEED_WINDOW (default 8)
+	sets the number of bits of the position per table lookup, see
+	bcnrand_host.inl. Requires C++14.
+
+	Note: bcnrand.h defines its own uint64_t and cannot be included in the
+	same translation unit as this file.
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_HOST_H
+#define BCNRAND_HOST_H
+
+#include <cstdint>
+
+#include "bcnrand_stats.h"
+#include "bcnrand_host.inl"
+
+namespace bcn {
+
+/*
+ * next
+ * Advances the state of the bcn generator by one step and returns the new state,
+ * z_k+1 = 2^53 z_k mod 3^33. The random variate is next(state) * 3^-33.
+ */
+inline uint64_t next(uint64_t& state)
+{
+	return state = barrett_step_opt(state);
+}
+
+/*
+ * skip
+ * Advances the state of the bcn generator by n steps in O(log n) and returns the new state,
+ * the same as n calls of next(state). n can be any 64 bit number (it is taken modulo the period).
+ */
+inline uint64_t skip(uint64_t& state, uint64_t n)
+{
+	return state = BarrettSkip(state, n);
+}
+
+/*
+ * seed_combined
+ * Seeds of the combined generator for the element i of the sequence starting at position,
+ * the same as in Kernel_initGeneratorCombined: the bcn part is at the position + 53 i,
+ * the lcg part at the position + i (position + 53 i must fit in 64 bits).
+ */
+inline void seed_combined(uint64_t position, uint64_t i, uint64_t* s, uint64_t* s1)
+{
+	seedCombined(position + 53 * i, position + i, s, s1);
+}
+
+/*
+ * skip_combined
+ * Advances both states of the combined generator by n steps in O(log n),
+ * the same as n calls of randCombined
+ */
+inline void skip_combined(uint64_t& s, uint64_t& s1, uint64_t n)
+{
+	skipCombined(&s, &s1, n);
+}
+
+/*
+ * to_double
+ * Converts a state of the bcn generator to the random variate on (0,1)
+ */
+inline double to_double(uint64_t z)
+{
+	return BCN_minv * z;
+}
+
+/*
+ * bcnrandom_inline
+ * Generates the next random number in the sequence based on the provided seed
+ */
+inline double bcnrandom_inline(uint64_t* seed)
+{
+	return BCN_minv * next(*seed);
+}
+
+/*
+ * randCombined
+ * The combined generator - generates the next random number in the sequence based on the provided seeds
+ */
+inline double randCombined(uint64_t* s, uint64_t* s1)
+{
+	uint64_t rnd = randCombined_increment(s, s1);
+
+	if (rnd == 0)
+		return LCG_m1*LCG_m_inv;
+	else
+		return rnd*LCG_m_inv;
+}
+
+/*
+ * randCombined53
+ * The combined generator with the full resolution of a double: the same steps as randCombined,
+ * the variate is rnd53 2^-53 with rnd53 = (lcg 2^22 - bcn) mod 2^53 (see bcnrand_combined.h)
+ */
+inline double randCombined53(uint64_t* s, uint64_t* s1)
+{
+	uint64_t rnd = randCombined53_increment(s, s1);
+
+	if (rnd == 0)
+		return COMB_mask53*COMB_inv53;
+	else
+		return rnd*COMB_inv53;
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_HOST_H
@@ -0,0 +1,634 @@
+/* ************************************************************************** */
+/* * bcnrand_host.inl part of bcnrand_host.h                                * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+
+/*
+	Host (CPU) counterparts of the device functions in bcnrand.inl. The
+	arithmetic is done with the native unsigned __int128 type, so every
+	function here returns exactly the same value as its __device__ version,
+	and the sequences generated on the host and on the GPU are identical.
+*/
+
+namespace bcn {
+
+typedef unsigned __int128 uint128_t;
+
+/*
+	Constants used in Barrett reduction algorithm
+*/
+static const uint64_t	BCN_a    = 33554432ULL;					/* a = 2^25  */
+static const uint64_t	BCN_m    = 5559060566555523ULL;			/* m = 3^33  */
+static const uint64_t	BCN_r    = 5946243ULL;					/* r = m % a */
+static const uint64_t	BCN_mulo = 0x33D9481681D79DULL;			/* floor(2^106 / m) */
+static const uint64_t	BCN_q    = 165672915ULL;				/* m div a   */
+static const uint64_t	BCN_t	 = 2779530283277761ULL;			/* floor(m/2) */
+static const uint64_t	BCN_period = 3706040377703682ULL;		/* 2 3^32, period of the sequence */
+
+static const double	BCN_qinv = 6.0359896486399119614693807977001e-9;	/* 1.0 / (double)(BCN_q); */
+static const double	BCN_minv = 1.7988650924514300510763861722128e-16;	/* 1.0 / (double)(BCN_m); */
+static const double BCN_b	 = 9007199254740992.0;						/* 2^53 */
+
+/*
+	Constants used in lcg
+*/
+static const uint64_t 	LCG_m 		= 2147483649ULL;							/* m = 2^31 + 1  	*/
+static const uint64_t 	LCG_m1 		= 2147483648ULL;							/* m - 1			*/
+static const uint64_t 	LCG_a 		= 39373ULL;									/* a = 39373  		*/
+static const uint64_t 	LCG_period 	= 119304647ULL;								/* period of the lcg */
+static const double 	LCG_m_inv 	= 4.6566128709089882341637330901978e-10;	/* 1/m 				*/
+
+/*
+	Constants used in the 53 bit combined generator
+*/
+static const uint64_t 	COMB_mask53	= 9007199254740991ULL;						/* 2^53 - 1			*/
+static const double 	COMB_inv53	= 1.1102230246251565404236316680908e-16;	/* 2^-53			*/
+
+
+/*!
+ ---------------------------------------------
+	Function: umul128
+
+	INPUTS
+		a, b:	64 bit unsigned integers
+	OUTPUTS
+			the full 128 bit product a*b
+ ---------------------------------------------
+*/
+inline uint128_t	umul128(uint64_t	a, uint64_t	b)
+{
+	return (uint128_t)a * b;
+}
+
+/*!
+ ---------------------------------------------
+	Function: barrett_step_opt
+
+	INPUTS
+		rlo:	64 bit unsigned integer containing the
+				current iterate z_k of the generator
+	OUTPUTS
+				z_k+1 = 2^53 z_k mod 3^33
+ ---------------------------------------------
+	NOTES
+			Same operations as the barrett_step_opt macro.
+			2^53 - r2lo never exceeds 2^53 < 2 * 3^33, so the
+			final while loop of the device version runs at
+			most once and is replaced by a conditional
+			subtraction (a cmov, no branch).
+ ---------------------------------------------
+*/
+inline uint64_t	barrett_step_opt(uint64_t	rlo)
+{
+	uint64_t	r2lo;
+
+	r2lo = ((uint64_t)(umul128(rlo, BCN_mulo) >> 53) * BCN_m) & 0x1FFFFFFFFFFFFFULL;
+	rlo  = 0x20000000000000ULL - r2lo;
+	rlo -= (rlo >= BCN_m) ? BCN_m : 0;
+
+	return rlo;
+}
+
+/*!
+ ---------------------------------------------
+	Function: BarrettStep
+
+	INPUTS
+		r:	64 bit unsigned integer type containing
+			the current iterate of the seed algorithm
+			of the generator
+	q_t53:	64 bit unsigned integer type containing
+			the constant 2^2^i % 3^33 at the i'th
+			step in seeding the generator
+	OUTPUTS
+			64 bit unsigned integer type containing
+			the next iterate of the generator (z_k+1)
+ ---------------------------------------------
+	NOTES
+			The difference r1lo - r2lo is taken mod 2^54
+			and 2^54 < 4 * 3^33, so three conditional
+			subtractions give the same result as the while
+			loop of the device version for every input.
+ ---------------------------------------------
+*/
+inline uint64_t	BarrettStep(
+	uint64_t	z,
+	uint64_t	q_t53
+	)
+{
+	uint128_t	x;
+	uint64_t	q, r1lo, r2lo;
+
+	x = umul128(z, q_t53);
+	q = (uint64_t)(umul128((uint64_t)(x >> 52), BCN_mulo) >> 54);
+
+	r1lo = (uint64_t)x & 0x3FFFFFFFFFFFFFULL;
+	r2lo = (q * BCN_m) & 0x3FFFFFFFFFFFFFULL;
+
+	z  = (r1lo - r2lo) & 0x3FFFFFFFFFFFFFULL;
+	z -= (z >= BCN_m) ? BCN_m : 0;
+	z -= (z >= BCN_m) ? BCN_m : 0;
+	z -= (z >= BCN_m) ? BCN_m : 0;
+
+	return z;
+}
+
+/*!
+ ---------------------------------------------
+	Function: barrett_step_simple
+
+	INPUTS
+		rlo:	64 bit unsigned integer containing the
+				current iterate z_k of the generator
+	OUTPUTS
+				z_k+1 = 2^53 z_k mod 3^33
+ ---------------------------------------------
+	NOTES
+			Same operations as the barrett_step_simple
+			macro: the full Barrett reduction of the
+			product 2^53 z_k, with the while loop of the
+			device version. Kept for comparison (see
+			bcnrand_bench.cpp), barrett_step_opt is faster.
+ ---------------------------------------------
+*/
+inline uint64_t	barrett_step_simple(uint64_t	rlo)
+{
+	uint128_t	x;
+	uint64_t	qlo, r1lo, r2lo;
+
+	x = umul128(0x20000000000000ULL, rlo);
+	qlo = (uint64_t)(x >> 52);
+	qlo = (uint64_t)(umul128(qlo, BCN_mulo) >> 54);
+
+	r1lo = (uint64_t)x & 0x3FFFFFFFFFFFFFULL;
+	r2lo = (qlo * BCN_m) & 0x3FFFFFFFFFFFFFULL;
+	rlo = r1lo - r2lo;
+	if (r1lo < r2lo) rlo += 0x40000000000000ULL;
+	while (rlo >= BCN_m) rlo -= BCN_m;
+
+	return rlo;
+}
+
+/*!
+ ---------------------------------------------
+	Function: LCN_Inline
+
+	INPUTS
+		seed:	the current iterate z_k of the generator
+	OUTPUTS
+				z_k+1 = 2^53 z_k mod 3^33
+ ---------------------------------------------
+	NOTES
+			Same operations as LCN_Inline of bcnrand.inl:
+			two multiplications by 2^25 (and the shifts
+			by 2 and 1) with Schrage's method, the quotient
+			by q = m div 2^25 taken in double precision.
+			The shifts are done on unsigned integers (the
+			remainder can be negative).
+ ---------------------------------------------
+*/
+inline int64_t LCN_Inline(int64_t seed)
+{
+	int64_t	T1;
+
+	seed <<= 2;
+	T1 = (int64_t)(seed * BCN_qinv);
+	seed = (int64_t)(((uint64_t)(seed - T1 * (int64_t)BCN_q) << 25) - T1 * BCN_r);
+	seed += BCN_m;
+
+	seed <<= 1;
+	T1 = (int64_t)(seed * BCN_qinv);
+	seed = (int64_t)(((uint64_t)(seed - T1 * (int64_t)BCN_q) << 25) - T1 * BCN_r);
+	if (seed < 0) seed += BCN_m;
+
+	return seed;
+}
+
+
+/* ========= tables of the seeding and skip ahead functions =========*/
+
+/*
+	The tables are computed by the compiler (constexpr) rather than written
+	out as in bcnrand.inl. BCN_SEED_WINDOW is the number of bits of the
+	position consumed by one table lookup in BarrettInitBit and LCGInitBit.
+	A window of w bits costs ceil(52/w) - 1 Barrett steps and a table of
+	ceil(52/w) * 2^w entries:
+		w = 5:	10 steps,	 3 kB
+		w = 8:	 6 steps,	14 kB	(default)
+		w = 11:	 4 steps,	80 kB
+	Other widths are available as BarrettInitBit<w>(k) and LCGInitBit<w>(k),
+	all of them give the same values.
+*/
+#ifndef BCN_SEED_WINDOW
+#define BCN_SEED_WINDOW 8
+#endif
+
+static const int		BCN_period_bits = 52;						/* 2 3^32 < 2^52 */
+static const int		LCG_period_bits = 27;						/* 119304647 < 2^27 */
+
+constexpr uint64_t mulmod_const(uint64_t a, uint64_t b, uint64_t m)
+{
+	return (uint64_t)((uint128_t)a * b % m);
+}
+
+constexpr uint64_t powmod_const(uint64_t b, uint64_t e, uint64_t m)
+{
+	uint64_t r = 1;
+
+	for (; e; e >>= 1, b = mulmod_const(b, b, m))
+		if (e & 1)
+			r = mulmod_const(r, b, m);
+	return r;
+}
+
+/*
+	bcn[i][j] = 2^(j 2^(w i)) mod 3^33, the row 0 is multiplied by BCN_t
+	lcg[i][j] = 39373^(j 2^(w i)) mod (2^31+1), the row 0 is multiplied by 39373
+*/
+template <int W>
+struct seed_tables
+{
+	static_assert(W >= 1 && W <= 12, "window width of the seeding tables");
+
+	static const int	rows = (BCN_period_bits + W - 1) / W;
+	static const int	lcg_rows = (LCG_period_bits + W - 1) / W;
+
+	uint64_t	bcn[rows][1 << W];
+	uint64_t	lcg[lcg_rows][1 << W];
+};
+
+template <int W>
+constexpr seed_tables<W> make_seed_tables()
+{
+	seed_tables<W>	t{};
+	uint64_t		b = 2, a = LCG_a, p = 0;
+	int				i = 0, j = 0;
+
+	for (i = 0; i < seed_tables<W>::rows; i++)
+	{
+		p = (i == 0) ? BCN_t : 1;
+		for (j = 0; j < (1 << W); j++, p = mulmod_const(p, b, BCN_m))
+			t.bcn[i][j] = p;
+		b = powmod_const(b, 1ULL << W, BCN_m);
+	}
+	for (i = 0; i < seed_tables<W>::lcg_rows; i++)
+	{
+		p = (i == 0) ? LCG_a : 1;
+		for (j = 0; j < (1 << W); j++, p = mulmod_const(p, a, LCG_m))
+			t.lcg[i][j] = p;
+		a = powmod_const(a, 1ULL << W, LCG_m);
+	}
+	return t;
+}
+
+template <int W>
+struct seed_table
+{
+	static constexpr seed_tables<W> value = make_seed_tables<W>();
+};
+
+#if __cplusplus < 201703L
+template <int W> constexpr seed_tables<W> seed_table<W>::value;
+#endif
+
+/*
+	bcn[i] = 2^(53 2^i) mod 3^33, lcg[i] = 39373^(2^i) mod (2^31+1)
+*/
+struct skip_tables
+{
+	uint64_t	bcn[BCN_period_bits];
+	uint64_t	lcg[LCG_period_bits];
+};
+
+constexpr skip_tables make_skip_tables()
+{
+	skip_tables	t{};
+	int			i = 0;
+
+	t.bcn[0] = powmod_const(2, 53, BCN_m);
+	for (i = 1; i < BCN_period_bits; i++)
+		t.bcn[i] = mulmod_const(t.bcn[i-1], t.bcn[i-1], BCN_m);
+	t.lcg[0] = LCG_a;
+	for (i = 1; i < LCG_period_bits; i++)
+		t.lcg[i] = mulmod_const(t.lcg[i-1], t.lcg[i-1], LCG_m);
+	return t;
+}
+
+static constexpr skip_tables BCN_P = make_skip_tables();
+
+
+/*!
+ ---------------------------------------------
+	Function: BarrettInitBit
+
+	INPUTS
+		k:	64 bit unsigned integer containing the
+			lcg generator seed value (any value, it
+			is reduced modulo the period 2 3^32)
+	OUTPUTS
+			64 bit unsigned integer type containing
+			the final iterator of the lcg seed
+			algorithm
+ ---------------------------------------------
+	NOTES
+			Uses the precomputed iterates for W bit
+			subsets of the seed, k, see seed_tables.
+			The result is BCN_t 2^k mod 3^33, as on
+			the device
+ ---------------------------------------------
+*/
+template <int W = BCN_SEED_WINDOW>
+inline uint64_t BarrettInitBit(uint64_t k)
+{
+	const seed_tables<W>&	R = seed_table<W>::value;
+	const uint64_t			mask = (1ULL << W) - 1;
+	int						i;
+	uint64_t				q;
+
+	BCN_STAT_TIMER(barrett_seeds, barrett_ticks);
+
+	k %= BCN_period;
+	q = R.bcn[0][k & mask];
+
+	for (i = 1; i < R.rows; i++)
+	{
+		k = k >> W;
+		q = BarrettStep(q,R.bcn[i][k & mask]);
+	}
+
+	return q;
+}
+
+
+/*!
+ ---------------------------------------------
+	Function: BarrettSkip
+
+	INPUTS
+		z:	64 bit unsigned integer containing the
+			current iterate z_k of the generator
+		n:	64 bit unsigned integer, number of steps
+	OUTPUTS
+			64 bit unsigned integer containing z_k+n,
+			the same value as after n calls of
+			barrett_step_opt
+ ---------------------------------------------
+	NOTES
+			z_k+n = 2^(53 n) z_k mod 3^33. n is reduced
+			modulo the period 2 3^32 < 2^52, then z_k is
+			multiplied by BCN_P.bcn[i] = 2^(53 2^i) mod 3^33
+			for every bit i of n (at most 52 Barrett steps)
+ ---------------------------------------------
+*/
+inline uint64_t BarrettSkip(uint64_t z, uint64_t n)
+{
+	uint32_t	i;
+
+	n %= BCN_period;
+	for (i = 0; n; i++, n >>= 1)
+		if (n & 1)
+			z = BarrettStep(z, BCN_P.bcn[i]);
+
+	return z;
+}
+
+
+
+/* ========= auxiliary generator =============*/
+
+/*!
+ ---------------------------------------------
+	Function: LCGMod
+
+	INPUTS
+		x:	64 bit unsigned integer, x <= 2^62
+	OUTPUTS
+			x mod (2^31+1)
+ ---------------------------------------------
+	NOTES
+			No division: with x = h 2^31 + l and
+			2^31 = -1 mod (2^31+1), x = l - h, and
+			l - h is in [-2^31, 2^31), so one
+			conditional addition of 2^31+1 reduces
+			it (the products of two residues are
+			at most 2^62)
+ ---------------------------------------------
+*/
+inline uint64_t LCGMod(uint64_t x)
+{
+	int64_t r = (int64_t)(x & 0x7FFFFFFFULL) - (int64_t)(x >> 31);
+
+	return (uint64_t)(r < 0 ? r + (int64_t)LCG_m : r);
+}
+
+/*!
+ ---------------------------------------------
+	Function: LCGStep
+
+	INPUTS
+		s:	64 bit unsigned integer type containing
+			the current iterate of the seed algorithm
+			of the generator
+		a:	64 bit unsigned integer type containing
+			the constant 39373^(j*32^i) % (2^31+1) at the
+			i'th step in seeding the generator
+	OUTPUTS
+			64 bit unsigned integer type containing
+			the next iterate of the generator (z_k+1)
+ ---------------------------------------------
+*/
+inline uint64_t	LCGStep(uint64_t	s, uint64_t	a)
+{
+	return LCGMod(a * s);
+}
+
+/*!
+ ---------------------------------------------
+	Function: LCGInitBit
+
+	INPUTS
+		k:	64 bit unsigned integer containing the
+			lcg generator seed value (any value, it
+			is reduced modulo the period 119304647)
+	OUTPUTS
+			64 bit unsigned integer type containing
+			the final iterator of the lcg seed
+			algorithm
+ ---------------------------------------------
+	NOTES
+			The result is 39373^(k+1) mod (2^31+1), as
+			on the device. The period of the lcg is
+			119304647, a divisor of 2^30 - 1 (this is why
+			the rows 6-11 of BCN_AUX_R in bcnrand.inl
+			repeat the rows 0-5)
+ ---------------------------------------------
+*/
+template <int W = BCN_SEED_WINDOW>
+inline uint64_t LCGInitBit(uint64_t k)
+{
+	const seed_tables<W>&	R = seed_table<W>::value;
+	const uint64_t			mask = (1ULL << W) - 1;
+	int						i;
+	uint64_t				q;
+
+	BCN_STAT_TIMER(lcg_seeds, lcg_ticks);
+
+	k %= LCG_period;
+	q = R.lcg[0][k & mask];
+
+	for (i = 1; i < R.lcg_rows; i++)
+	{
+		k = k >> W;
+		q = LCGStep(q,R.lcg[i][k & mask]);
+	}
+
+	return q;
+}
+
+
+/*!
+ ---------------------------------------------
+	Function: LCGSkip
+
+	INPUTS
+		s:	64 bit unsigned integer containing the
+			current iterate s_k of the lcg
+		n:	64 bit unsigned integer, number of steps
+	OUTPUTS
+			64 bit unsigned integer containing s_k+n,
+			the same value as after n calls of
+			randlcgSimple_increment
+ ---------------------------------------------
+	NOTES
+			s_k+n = 39373^n s_k mod (2^31+1), with n
+			reduced modulo the period 119304647 < 2^27
+			and BCN_P.lcg[i] = 39373^(2^i) mod (2^31+1)
+ ---------------------------------------------
+*/
+inline uint64_t LCGSkip(uint64_t s, uint64_t n)
+{
+	uint32_t	i;
+
+	n %= LCG_period;
+	for (i = 0; n; i++, n >>= 1)
+		if (n & 1)
+			s = LCGStep(s, BCN_P.lcg[i]);
+
+	return s;
+}
+
+
+/*!
+ ---------------------------------------------
+	Function: seedCombined
+
+	INPUTS
+		count:	 starting position of the bcn generator
+		count1:	 starting position of the auxiliary lcg
+	OUTPUTS
+		seed, lcgseed:	the two seeds of the combined generator
+ ---------------------------------------------
+*/
+inline void seedCombined(uint64_t count, uint64_t count1, uint64_t* seed, uint64_t* lcgseed)
+{
+	*seed=BarrettInitBit(count);
+	*lcgseed=LCGInitBit(count1);
+}
+
+
+/*!
+ ---------------------------------------------
+	Function: skipCombined
+
+	INPUTS
+		seed, lcgseed:	pointers to the two seeds of the
+						combined generator
+		n:				number of steps
+	OUTPUTS
+		nil
+ ---------------------------------------------
+	NOTES:
+		Updates both seeds as n calls of randCombined_increment,
+		the bcn part by BarrettSkip and the lcg part by LCGSkip
+ ---------------------------------------------
+*/
+inline void skipCombined(uint64_t* seed, uint64_t* lcgseed, uint64_t n)
+{
+	*seed=BarrettSkip(*seed, n);
+	*lcgseed=LCGSkip(*lcgseed, n);
+}
+
+
+/*!
+ ---------------------------------------------
+	Function: randlcgSimple_increment
+
+	INPUTS
+		z:		pointer to 64 bit integer
+				containing the k'th iterate beyond
+				the seed iterate
+	OUTPUTS
+		r:		64 bit integer type holding
+				the value of z_k+1
+ ---------------------------------------------
+	COMPUTES:
+		z_k+1 = 39373 z_k mod 2^31 + 1
+		r = z_k+1
+	NOTES:
+		Updates input z_k to z_k+1
+ ---------------------------------------------
+*/
+inline uint64_t randlcgSimple_increment( uint64_t *z )
+{
+	return *z = LCGMod(LCG_a * *z);
+}
+
+/*!
+ ---------------------------------------------
+	Function: randCombined_increment
+
+	INPUTS
+				pointers to 64 bit integer
+				containing the k'th iterate beyond
+				the seed iterate
+	OUTPUTS
+		rnd:	64 bit uint64_t type
+ ---------------------------------------------
+	COMPUTES:
+		rnd = LCG()-BCN() mod LCG_m - 1
+ ---------------------------------------------
+*/
+inline uint64_t randCombined_increment(uint64_t *SeedBCN_z_k, uint64_t *SeedLCG_z_k)
+{
+	*SeedBCN_z_k = barrett_step_opt(*SeedBCN_z_k);
+	return (randlcgSimple_increment(SeedLCG_z_k) - *SeedBCN_z_k) & 0x7FFFFFFFULL;
+}
+
+/*!
+ ---------------------------------------------
+	Function: randCombined53_increment
+
+	INPUTS
+				pointers to 64 bit integer
+				containing the k'th iterate beyond
+				the seed iterate
+	OUTPUTS
+		rnd:	64 bit uint64_t type, 53 bits
+ ---------------------------------------------
+	COMPUTES:
+		rnd = LCG() 2^22 - BCN() mod 2^53
+ ---------------------------------------------
+	NOTES:
+		The same steps as randCombined_increment,
+		with the lcg aligned to the top of 53 bits
+ ---------------------------------------------
+*/
+inline uint64_t randCombined53_increment(uint64_t *SeedBCN_z_k, uint64_t *SeedLCG_z_k)
+{
+	*SeedBCN_z_k = barrett_step_opt(*SeedBCN_z_k);
+	return ((randlcgSimple_increment(SeedLCG_z_k) << 22) - *SeedBCN_z_k) & COMB_mask53;
+}
+
+} // namespace bcn
@@ -0,0 +1,166 @@
+/* ************************************************************************** */
+/* * bcnrand_kernel.h                                                       * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	The loop of the generation kernels, shared by the CUDA version (bcnrand.h)
+	and the host version (bcnrand_simd.h). Kernel_Opt, Kernel_Opt_Multistep,
+	Kernel_Constant_Unrolled, Kernel_CountValues and Kernel_CountValues_Combined
+	are all
+		run_stream<Unroll>(step, out, WorkPerThread)
+	with a step policy (which generator), an output policy (what is done with
+	each number) and the unroll factor, all known at compile time, so that the
+	step and the consumer are inlined in one loop. WorkPerThread does not have
+	to be a multiple of Unroll, the remainder is generated one by one.
+
+	A step policy is a class with
+		result_type						the raw number (state or rnd)
+		result_type next()				the next raw number
+		template <int U>
+		void next_block(result_type* r)	the next U raw numbers
+		double variate(result_type r)	the random variate on (0,1)
+		void store(T* p, result_type r)	writes r in the format of T
+	The policies of the generators are defined by each backend (bcn_step,
+	combined_step, multistep_step and constant_step in bcnrand.h and in
+	bcnrand_simd.h), since the device and the host steps differ.
+
+	An output policy is called as out(i, step, r) for the element i of the
+	stream; strided_output, count_output and functor_output are below.
+
+	This file includes nothing: it is included by bcnrand.h after its own
+	integer types, and by bcnrand_simd.h. The templates are in namespace bcn
+	for both compilers (nvcc accepts it in device code), so that the host
+	code gets no global names such as below; the kernels of bcnrand.h use
+	them as bcn::run_stream etc.
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_KERNEL_H
+#define BCNRAND_KERNEL_H
+
+#if defined(__CUDACC__)
+#define BCN_HOSTDEV __host__ __device__
+#else
+#define BCN_HOSTDEV
+#endif
+
+#if defined(__CUDACC__) || defined(__clang__)
+#define BCN_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define BCN_UNROLL _Pragma("GCC unroll 16")
+#else
+#define BCN_UNROLL
+#endif
+
+namespace bcn {
+
+/*
+ * run_stream
+ * Calls out(i, step, r) with the next raw number r of the step policy, i = 0..work-1,
+ * Unroll numbers per iteration and the remainder one by one
+ */
+template <int Unroll, class Step, class Output, class Index>
+BCN_HOSTDEV inline void run_stream(Step& step, Output& out, Index work)
+{
+	typename Step::result_type	r[Unroll];
+	Index						i = 0;
+
+	for (; work - i >= (Index)Unroll; i += Unroll)
+	{
+		step.template next_block<Unroll>(r);
+
+		BCN_UNROLL
+		for (int j = 0; j < Unroll; j++)
+			out(i + j, step, r[j]);
+	}
+	// fewer than Unroll left
+	for (int j = 0; j < Unroll - 1 && (Index)j < work - i; j++)
+		out(i + j, step, step.next());
+}
+
+/*
+ * strided_output
+ * Writes the element i to p[i stride] in the format of T (the layout of Kernel_Opt: the
+ * threads of a block write consecutive addresses, stride = the number of threads)
+ */
+template <class T>
+struct strided_output
+{
+	T*		p;
+	size_t	stride;
+
+	template <class Step, class Index>
+	BCN_HOSTDEV void operator()(Index i, const Step& step, typename Step::result_type r)
+	{
+		step.store(p + i * stride, r);
+	}
+};
+
+template <class T>
+BCN_HOSTDEV inline strided_output<T> make_strided_output(T* p, size_t stride)
+{
+	strided_output<T> out = { p, stride };
+	return out;
+}
+
+/*
+ * count_output
+ * Counts the variates for which pred(u) is true (Kernel_CountValues)
+ */
+template <class Pred>
+struct count_output
+{
+	Pred			pred;
+	unsigned int	count;
+
+	template <class Step, class Index>
+	BCN_HOSTDEV void operator()(Index, const Step& step, typename Step::result_type r)
+	{
+		count += pred(step.variate(r)) ? 1 : 0;
+	}
+};
+
+template <class Pred>
+BCN_HOSTDEV inline count_output<Pred> make_count_output(const Pred& pred)
+{
+	count_output<Pred> out = { pred, 0 };
+	return out;
+}
+
+/*
+ * functor_output
+ * Passes every variate to f(u)
+ */
+template <class F>
+struct functor_output
+{
+	F		f;
+
+	template <class Step, class Index>
+	BCN_HOSTDEV void operator()(Index, const Step& step, typename Step::result_type r)
+	{
+		f(step.variate(r));
+	}
+};
+
+template <class F>
+BCN_HOSTDEV inline functor_output<F> make_functor_output(const F& f)
+{
+	functor_output<F> out = { f };
+	return out;
+}
+
+/* the predicate u < t of the counting kernels */
+struct below
+{
+	double	t;
+
+	BCN_HOSTDEV bool operator()(double u) const { return u < t; }
+};
+
+} // namespace bcn
+
+#endif // BCNRAND_KERNEL_H
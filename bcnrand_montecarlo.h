@@ -0,0 +1,183 @@
+/* ************************************************************************** */
+/* * bcnrand_montecarlo.h                                                   * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Monte Carlo reductions on the host, the generalisation of the kernels
+	Kernel_CountValues and Kernel_CountValues_Combined: the random variates
+	are generated, passed to a user function and reduced in one pass, and the
+	sequence is never stored (only a chunk of BCN_MC_LEAF variates in L1).
+
+	monte_carlo(n, position, sample, reduce) returns
+			reduce(... reduce(sample(x_0), sample(x_1)) ..., sample(x_n-1))
+	for the n variates x_i of the sequence starting at position, with the
+	terms grouped in a fixed tree: leaves of BCN_MC_LEAF consecutive draws
+	are reduced from left to right, then the leaves are reduced pairwise
+	(a balanced binary tree in the order of the sequence). The grouping only
+	depends on n, not on the threads that computed the leaves, so floating
+	point sums are bit for bit the same for any number of threads. The
+	threads of the pool take segments of BCN_MC_SEGMENT leaves, each
+	reduced in a partial accumulator of the thread.
+
+	sample(x) is called with each variate (double, or the type given as
+	the first template argument, see the kernels in bcnrand_simd.h) and
+	returns a value of the result type; reduce(a, b) must be associative
+	(up to rounding) with the identity Result(), or the one given.
+	Both are called concurrently by the threads.
+
+	Usage:
+			// the number of variates below 0.9, as Kernel_CountValues
+			uint64_t count = bcn::monte_carlo(n, seed,
+				[](double u) { return (uint64_t)(u < 0.9); }, std::plus<uint64_t>());
+
+			// the mean of f, the same double with any BCNRAND_THREADS
+			double mean = bcn::monte_carlo(n, seed, f, std::plus<double>()) / n;
+
+		monte_carlo_combined does the same with the variates of randCombined,
+		as Kernel_CountValues_Combined, and monte_carlo_combined<53> with those
+		of randCombined53 (53 bits, for the estimates of small probabilities).
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_MONTECARLO_H
+#define BCNRAND_MONTECARLO_H
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bcnrand_combined.h"
+#include "bcnrand_pool.h"
+
+namespace bcn {
+
+static const uint64_t	BCN_MC_LEAF = 1024;			/* draws reduced from left to right */
+static const uint64_t	BCN_MC_SEGMENT = 1024;		/* leaves per task */
+
+/*
+ * pairwise
+ * Reduces the values added in order by a balanced binary tree, keeping one
+ * partial result per level: the value k is merged with the partial results
+ * of its subtrees when k + 1 is a multiple of 2, 4, 8, ...
+ */
+template <class Result, class Reducer>
+class pairwise
+{
+public:
+	explicit pairwise(const Reducer& reduce) : m_reduce(reduce), m_depth(0), m_count(0) {}
+
+	void add(const Result& v)
+	{
+		m_stack[m_depth++] = v;
+		for (uint64_t c = ++m_count; !(c & 1); c >>= 1, m_depth--)
+			m_stack[m_depth - 2] = m_reduce(m_stack[m_depth - 2], m_stack[m_depth - 1]);
+	}
+
+	/* the reduction of the values added so far (of the incomplete subtrees from the right) */
+	Result result(const Result& identity) const
+	{
+		if (m_depth == 0)
+			return identity;
+
+		Result r = m_stack[m_depth - 1];
+		for (int k = m_depth - 2; k >= 0; k--)
+			r = m_reduce(m_stack[k], r);
+		return r;
+	}
+
+private:
+	const Reducer&	m_reduce;
+	Result			m_stack[64];
+	int				m_depth;
+	uint64_t		m_count;
+};
+
+/*
+ * monte_carlo_engine
+ * The reduction over the n draws; seeder(first) returns the function draw(x, len) that writes
+ * the next len variates of the sequence, from the element first on
+ */
+template <class T, class Result, class Seeder, class Sampler, class Reducer>
+inline Result monte_carlo_engine(uint64_t n, Seeder seeder, const Sampler& sample, const Reducer& reduce,
+								 const Result& identity)
+{
+	const uint64_t	segment = BCN_MC_LEAF * BCN_MC_SEGMENT;
+	const uint64_t	nsegments = (n + segment - 1) / segment;
+	std::vector<Result> partial((size_t)nsegments, identity);
+
+	default_pool().run((unsigned int)nsegments, [&](unsigned int s)
+	{
+		alignas(64) T	x[BCN_MC_LEAF];
+		uint64_t		first = s * segment, last = first + segment < n ? first + segment : n;
+		pairwise<Result, Reducer> tree(reduce);
+		auto			draw = seeder(first);
+
+		for (; first < last; first += BCN_MC_LEAF)
+		{
+			size_t	len = (size_t)(last - first < BCN_MC_LEAF ? last - first : BCN_MC_LEAF);
+			Result	acc = identity;
+
+			draw(x, len);
+			for (size_t i = 0; i < len; i++)
+				acc = reduce(acc, sample(x[i]));
+			tree.add(acc);
+		}
+		partial[s] = tree.result(identity);
+	});
+
+	// the segments are whole subtrees of the same tree
+	pairwise<Result, Reducer> tree(reduce);
+	for (uint64_t s = 0; s < nsegments; s++)
+		tree.add(partial[(size_t)s]);
+	return tree.result(identity);
+}
+
+/*
+ * monte_carlo
+ * Reduces sample(x_i) for the n random variates x_i of the sequence starting at position,
+ * in parallel, with the same result for any number of threads (see above)
+ * Parameters:
+ *	n:			input, number of random variates
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ *	sample:		input, the function of a variate of type T (double, float, uint32_t, q32,
+ *				or uint64_t for the raw states)
+ *	reduce:		input, the associative reduction of two results
+ *	identity:	input, the identity of reduce
+ */
+template <class T = double, class Sampler, class Reducer, class Result = typename std::decay<decltype(std::declval<const Sampler&>()(T()))>::type>
+inline Result monte_carlo(uint64_t n, uint64_t position, const Sampler& sample, const Reducer& reduce,
+						  const Result& identity = Result())
+{
+	return monte_carlo_engine<T>(n, [=](uint64_t first)
+	{
+		uint64_t state = BarrettInitBit(position + 53 * first);
+
+		return [=](T* x, size_t len) mutable { generate(state, x, len); };
+	}, sample, reduce, identity);
+}
+
+/*
+ * monte_carlo_combined
+ * The same as monte_carlo with the variates of randCombined (double only), the element i
+ * seeded as in Kernel_initGeneratorCombined; monte_carlo_combined<53> uses randCombined53,
+ * one step of the generators per full precision variate
+ */
+template <int Bits = 31, class Sampler, class Reducer, class Result = typename std::decay<decltype(std::declval<const Sampler&>()(0.0))>::type>
+inline Result monte_carlo_combined(uint64_t n, uint64_t position, const Sampler& sample, const Reducer& reduce,
+								   const Result& identity = Result())
+{
+	return monte_carlo_engine<double>(n, [=](uint64_t first)
+	{
+		uint64_t s, s1;
+
+		seed_combined(position, first, &s, &s1);
+		return [=](double* x, size_t len) mutable { generate_combined<Bits>(s, s1, x, len); };
+	}, sample, reduce, identity);
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_MONTECARLO_H
@@ -0,0 +1,190 @@
+/* ************************************************************************** */
+/* * bcnrand_pool.h                                                         * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	A minimal pool of worker threads for the host version of bcnrand. It plays
+	the role of the grid of CUDA threads: run(ntasks, f) calls f(0), ...,
+	f(ntasks-1) on the workers and the calling thread, and returns when all
+	of them have finished. Which worker runs which task is not defined, so
+	the tasks must only depend on their index (as the kernels in bcnrand.h
+	only depend on the thread index).
+
+	The default pool has one thread per core, or BCNRAND_THREADS threads if
+	this environment variable is set.
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_POOL_H
+#define BCNRAND_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bcn {
+
+/*
+ * default_num_threads
+ * BCNRAND_THREADS if set, otherwise the number of cores
+ */
+inline unsigned int default_num_threads()
+{
+	const char* env = getenv("BCNRAND_THREADS");
+	int n = env ? atoi(env) : 0;
+
+	if (n > 0)
+		return n;
+	n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+class thread_pool
+{
+public:
+	/* nthreads includes the calling thread, nthreads - 1 workers are started */
+	explicit thread_pool(unsigned int nthreads)
+		: m_size(nthreads ? nthreads : 1), m_generation(0), m_stop(false),
+		  m_func(0), m_ntasks(0), m_done(0), m_active(0), m_task(0)
+	{
+		for (unsigned int i = 1; i < m_size; i++)
+			m_workers.push_back(std::thread(&thread_pool::worker, this));
+	}
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (size_t i = 0; i < m_workers.size(); i++)
+			m_workers[i].join();
+	}
+
+	unsigned int size() const { return m_size; }
+
+	/*
+	 * run
+	 * Executes f(t) for t = 0..ntasks-1 and waits for completion. Calls from a
+	 * task of this pool are executed serially by the calling thread.
+	 */
+	void run(unsigned int ntasks, const std::function<void(unsigned int)>& f)
+	{
+		if (ntasks <= 1 || m_size == 1 || in_worker())
+		{
+			for (unsigned int t = 0; t < ntasks; t++)
+				f(t);
+			return;
+		}
+
+		std::lock_guard<std::mutex> serial(m_run);
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// workers still leaving the previous run must not see the new tasks
+		m_finished.wait(lock, [this] { return m_active == 0; });
+		m_func = &f;
+		m_ntasks = ntasks;
+		m_done = 0;
+		m_task = 0;
+		m_generation++;
+		lock.unlock();
+		m_wake.notify_all();
+
+		in_worker() = true;
+		execute(&f, ntasks);
+		in_worker() = false;
+
+		lock.lock();
+		m_finished.wait(lock, [this] { return m_done == m_ntasks && m_active == 0; });
+		m_func = 0;
+	}
+
+private:
+	static bool& in_worker()
+	{
+		static thread_local bool flag = false;
+		return flag;
+	}
+
+	/* claims tasks until none are left */
+	void execute(const std::function<void(unsigned int)>* f, unsigned int ntasks)
+	{
+		unsigned int t, n = 0;
+
+		while ((t = m_task.fetch_add(1)) < ntasks)
+		{
+			(*f)(t);
+			n++;
+		}
+		if (n)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done += n;
+			if (m_done == m_ntasks)
+				m_finished.notify_all();
+		}
+	}
+
+	void worker()
+	{
+		const std::function<void(unsigned int)>* f;
+		unsigned long	seen = 0;
+		unsigned int	ntasks;
+
+		in_worker() = true;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+				if (m_stop)
+					return;
+				seen = m_generation;
+				f = m_func;
+				ntasks = m_ntasks;
+				m_active++;
+			}
+			execute(f, ntasks);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_active == 0)
+					m_finished.notify_all();
+			}
+		}
+	}
+
+	unsigned int				m_size;
+	std::vector<std::thread>	m_workers;
+	std::mutex					m_mutex, m_run;
+	std::condition_variable		m_wake, m_finished;
+	unsigned long				m_generation;
+	bool						m_stop;
+
+	const std::function<void(unsigned int)>*	m_func;
+	unsigned int				m_ntasks;
+	unsigned int				m_done;
+	unsigned int				m_active;
+	std::atomic<unsigned int>	m_task;
+};
+
+/*
+ * default_pool
+ * The pool shared by the bulk functions of bcnrand, created on first use
+ */
+inline thread_pool& default_pool()
+{
+	static thread_pool pool(default_num_threads());
+	return pool;
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_POOL_H
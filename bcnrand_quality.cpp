@@ -0,0 +1,96 @@
+/* ************************************************************************** */
+/* * bcnrand_quality.cpp                                                    * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*
+ * Runs the statistical tests of bcnrand_quality.h on an engine of the host version
+ *
+ * Call from the command line:  ./bcnrand_quality 100000000000 bcn 112
+ * arguments: the number of variates, the engine (bcn, scalar, multistep, combined,
+ * combined53, default bcn), the starting position (default 112). The number of threads is set by
+ * the environment variable BCNRAND_THREADS, the results do not depend on it.
+ *
+ * Prints the statistic and the p-value of every test, in the format of the summary
+ * of TestU01, and exits with 1 if a p-value is outside [10^-10, 1 - 10^-10], so that
+ * it can be used in scripts. The tests that need more variates than n (the replications
+ * of birthday spacings and close pairs) are reported as skipped and do not fail.
+ *
+ *	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bcnrand_quality.h"
+
+using namespace bcn;
+
+int main(int argc, char **argv)
+{
+	test_engine	engine = TEST_BCN;
+	uint64_t	n, position = 112;
+	int			failed = 0;
+
+	if (argc < 2 || argc > 4)
+	{
+		printf("Usage ./bcnrand_quality <Number Elements> [bcn|scalar|multistep|combined|combined53] [Seed]\nNow Exiting\n");
+		exit(0);
+	}
+	n = strtoull(argv[1], 0, 10);
+	if (argc > 2)
+	{
+		int e;
+
+		for (e = 0; e < TEST_ENGINES; e++)
+			if (strcmp(argv[2], test_engine_name((test_engine)e)) == 0)
+				break;
+		if (e == TEST_ENGINES)
+		{
+			printf("Unknown engine %s\nNow Exiting\n", argv[2]);
+			exit(0);
+		}
+		engine = (test_engine)e;
+	}
+	if (argc > 3)
+		position = strtoull(argv[3], 0, 10);
+
+	printf("engine %s (%s), %llu variates from position %llu, %u threads\n", test_engine_name(engine),
+		   isa_name(cpu_isa()), (unsigned long long)n, (unsigned long long)position, default_pool().size());
+
+	std::vector<stat_test*> tests = default_tests();
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	run_tests(tests, engine, n, position);
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	printf("\n       Test                                     statistic        p-value\n");
+	printf(" ------------------------------------------------------------------------\n");
+	for (size_t i = 0; i < tests.size(); i++)
+	{
+		test_result r = tests[i]->result();
+		const char*	flag = "";
+
+		if (r.skipped)
+		{
+			printf(" %2d  %-40s %14s   %10s  skipped, n too small\n", (int)i + 1, r.name, "-", "-");
+			continue;
+		}
+		if (r.p_value < 1e-10 || r.p_value > 1 - 1e-10)
+		{
+			flag = "  FAIL";
+			failed = 1;
+		}
+		else if (r.p_value < 0.001 || r.p_value > 0.999)
+			flag = "  suspect";
+		printf(" %2d  %-40s %14.2f   %10.3g%s\n", (int)i + 1, r.name, r.statistic, r.p_value, flag);
+	}
+	printf(" ------------------------------------------------------------------------\n");
+	printf(" %.2f s, %.2f ns per variate\n", sec, sec * 1e9 / n);
+
+	delete_tests(tests);
+	return failed;
+}
@@ -0,0 +1,851 @@
+/* ************************************************************************** */
+/* * bcnrand_quality.h                                                      * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Statistical tests of the host engines, run in parallel on the bulk output
+	of the generator. The tests are those of TestU01 that distinguish the
+	basic and the combined generators (birthday spacings, closed pairs), and
+	the chi-square equidistribution, serial (pairs) and gap tests of Knuth.
+
+	The sequence is cut into blocks. Every block is generated by one task of
+	the pool, from its own seed, in chunks of BCN_TEST_CHUNK variates that
+	stay in L1 and are passed to all the tests as they are written by the
+	engine. Each test keeps one accumulator per block, and the accumulators
+	are merged in the order of the blocks, so the statistics do not depend
+	on the number of threads (the size of the pool, BCNRAND_THREADS).
+	Birthday spacings and closed pairs are made of replications, which must
+	be as large as in TestU01 to see the lattice of the bcn generator
+	(birthday spacings in t = 2 with 2^22 points, 2^23 variates). Their
+	blocks are a whole number of replications, at least BCN_TEST_BLOCK
+	variates (block_size()), and run_tests makes one pass over the sequence
+	for every block size, so no replication is cut by a block; only the
+	variates after the last whole replication of n are not used, and a test
+	without any whole replication is skipped (result().skipped). A
+	replication keeps what it needs of the points until it is complete:
+	birthday spacings the days (8 bytes per point), closed pairs a copy of
+	the coordinates; a task of the default battery holds about 64 MB.
+
+	Every test gives a statistic and its right p-value, P(X >= x); as in
+	TestU01 a p-value outside [0.001, 0.999] is suspect, and outside
+	[10^-10, 1 - 10^-10] a clear failure.
+
+	Usage:
+			std::vector<bcn::stat_test*> tests = bcn::default_tests();
+			bcn::run_tests(tests, bcn::TEST_BCN, 100000000000ULL, seed);
+			for (i = 0 ; i < tests.size() ; i++)
+				r = tests[i]->result();			// r.name, r.statistic, r.p_value
+			bcn::delete_tests(tests);
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_QUALITY_H
+#define BCNRAND_QUALITY_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bcnrand_combined.h"
+#include "bcnrand_pool.h"
+
+namespace bcn {
+
+static const uint64_t	BCN_TEST_BLOCK = 1 << 20;		/* least variates per task */
+static const size_t		BCN_TEST_CHUNK = 1024;			/* variates passed to the tests at once */
+
+
+/* ========================= p-values ========================= */
+
+/*
+ * gamma_p, gamma_q
+ * The regularized incomplete gamma functions P(a, x) and Q(a, x) = 1 - P(a, x),
+ * by the series or the continued fraction (whichever converges), each computed
+ * directly so that small tails keep their relative precision
+ */
+inline double gamma_series(double a, double x)
+{
+	double	sum = 1 / a, term = sum;
+
+	for (int n = 1; n < 100000; n++)
+	{
+		term *= x / (a + n);
+		sum += term;
+		if (term < sum * 1e-16)
+			break;
+	}
+	return sum * exp(-x + a * log(x) - lgamma(a));
+}
+
+inline double gamma_fraction(double a, double x)
+{
+	const double tiny = 1e-300;
+	double	b = x + 1 - a, c = 1 / tiny, d = 1 / b, h = d;
+
+	for (int n = 1; n < 100000; n++)
+	{
+		double an = -n * (n - a);
+
+		b += 2;
+		d = an * d + b;
+		if (fabs(d) < tiny)
+			d = tiny;
+		c = b + an / c;
+		if (fabs(c) < tiny)
+			c = tiny;
+		d = 1 / d;
+		h *= d * c;
+		if (fabs(d * c - 1) < 1e-16)
+			break;
+	}
+	return h * exp(-x + a * log(x) - lgamma(a));
+}
+
+inline double gamma_p(double a, double x)
+{
+	if (x <= 0)
+		return 0;
+	return x < a + 1 ? gamma_series(a, x) : 1 - gamma_fraction(a, x);
+}
+
+inline double gamma_q(double a, double x)
+{
+	if (x <= 0)
+		return 1;
+	return x < a + 1 ? 1 - gamma_series(a, x) : gamma_fraction(a, x);
+}
+
+/* P(X >= x) for the chi-square distribution with dof degrees of freedom */
+inline double chi2_pvalue(double x, double dof)
+{
+	return gamma_q(dof / 2, x / 2);
+}
+
+/* P(Y >= y) for the Poisson distribution with the mean lambda */
+inline double poisson_pvalue(uint64_t y, double lambda)
+{
+	return y == 0 ? 1 : gamma_p((double)y, lambda);
+}
+
+/* the chi-square statistic of the counts with the given probabilities of the classes */
+inline double chi2_statistic(const uint64_t* count, const double* prob, int k, uint64_t n)
+{
+	double	x = 0;
+
+	for (int i = 0; i < k; i++)
+	{
+		double e = prob[i] * n;
+		x += (count[i] - e) * (count[i] - e) / e;
+	}
+	return x;
+}
+
+
+/* ========================= the tests ========================= */
+
+struct test_result
+{
+	char		name[64];
+	double		statistic;
+	double		p_value;
+	uint64_t	n;				/* variates used */
+	bool		skipped;		/* too few variates for the test, no statistic */
+};
+
+/*
+ * stat_test
+ * One test: an accumulator of the statistics of one block of the sequence.
+ * clone() gives an empty accumulator with the same parameters, consume() is called
+ * with the consecutive chunks of the block, finish() at the end of the block (to
+ * release the buffers), and merge() adds the accumulator of the following block.
+ * block_size() is the length of the blocks of the test.
+ */
+class stat_test
+{
+public:
+	virtual ~stat_test() {}
+	virtual stat_test*	clone() const = 0;
+	virtual void		consume(const double* u, size_t n) = 0;
+	virtual void		finish() {}
+	virtual void		merge(const stat_test& next) = 0;
+	virtual test_result	result() const = 0;
+	virtual uint64_t	block_size() const { return BCN_TEST_BLOCK; }
+
+protected:
+	static test_result make_result(double statistic, double p_value, uint64_t n, const char* fmt, ...)
+		__attribute__((format(printf, 4, 5)))
+	{
+		test_result r;
+		va_list		args;
+
+		va_start(args, fmt);
+		vsnprintf(r.name, sizeof(r.name), fmt, args);
+		va_end(args);
+		r.statistic = statistic;
+		r.p_value = p_value;
+		r.n = n;
+		r.skipped = false;
+		return r;
+	}
+};
+
+/*
+ * chi2_test
+ * Equidistribution: the counts of floor(u 2^bits) in 2^bits classes
+ */
+class chi2_test : public stat_test
+{
+public:
+	explicit chi2_test(int bits = 12) : m_bits(bits), m_count((size_t)1 << bits, 0), m_n(0) {}
+
+	stat_test* clone() const { return new chi2_test(m_bits); }
+
+	void consume(const double* u, size_t n)
+	{
+		const double scale = (double)m_count.size();
+
+		for (size_t i = 0; i < n; i++)
+			m_count[(size_t)(u[i] * scale)]++;
+		m_n += n;
+	}
+
+	void merge(const stat_test& next)
+	{
+		const chi2_test& b = static_cast<const chi2_test&>(next);
+
+		for (size_t i = 0; i < m_count.size(); i++)
+			m_count[i] += b.m_count[i];
+		m_n += b.m_n;
+	}
+
+	test_result result() const
+	{
+		std::vector<double> p(m_count.size(), 1.0 / m_count.size());
+		double x = chi2_statistic(m_count.data(), p.data(), (int)m_count.size(), m_n);
+
+		return make_result(x, chi2_pvalue(x, m_count.size() - 1.0), m_n, "chi2, %d bins", (int)m_count.size());
+	}
+
+private:
+	int						m_bits;
+	std::vector<uint64_t>	m_count;
+	uint64_t				m_n;
+};
+
+/*
+ * serial_test
+ * Non overlapping pairs (u_2i, u_2i+1) in d x d cells, d = 2^bits
+ */
+class serial_test : public stat_test
+{
+public:
+	explicit serial_test(int bits = 6) : m_bits(bits), m_count((size_t)1 << (2 * bits), 0), m_n(0), m_first(-1) {}
+
+	stat_test* clone() const { return new serial_test(m_bits); }
+
+	void consume(const double* u, size_t n)
+	{
+		const double d = (double)(1 << m_bits);
+		size_t		 i = 0;
+
+		if (m_first >= 0 && n)
+		{
+			m_count[((size_t)m_first << m_bits) | (size_t)(u[0] * d)]++;
+			m_first = -1;
+			i = 1;
+		}
+		for (; i + 1 < n; i += 2)
+			m_count[((size_t)(u[i] * d) << m_bits) | (size_t)(u[i + 1] * d)]++;
+		if (i < n)
+			m_first = (int)(u[i] * d);
+		m_n += n;
+	}
+
+	void merge(const stat_test& next)
+	{
+		const serial_test& b = static_cast<const serial_test&>(next);
+
+		for (size_t i = 0; i < m_count.size(); i++)
+			m_count[i] += b.m_count[i];
+		m_n += b.m_n;
+	}
+
+	test_result result() const
+	{
+		std::vector<double> p(m_count.size(), 1.0 / m_count.size());
+		uint64_t pairs = 0;
+
+		for (size_t i = 0; i < m_count.size(); i++)
+			pairs += m_count[i];
+
+		double x = chi2_statistic(m_count.data(), p.data(), (int)m_count.size(), pairs);
+
+		return make_result(x, chi2_pvalue(x, m_count.size() - 1.0), m_n, "serial pairs, %d x %d", 1 << m_bits, 1 << m_bits);
+	}
+
+private:
+	int						m_bits;
+	std::vector<uint64_t>	m_count;
+	uint64_t				m_n;
+	int						m_first;		/* the first coordinate of a pair split by the chunks, or -1 */
+};
+
+/*
+ * gap_test
+ * The lengths of the gaps between the variates in [0, 2^-bits), the lengths 0..t-2 and
+ * >= t-1 in t classes. The gaps that cross the blocks are joined by merge.
+ */
+class gap_test : public stat_test
+{
+public:
+	explicit gap_test(int bits = 3, int t = 64)
+		: m_bits(bits), m_count(t, 0), m_n(0), m_hit(false), m_prefix(0), m_suffix(0) {}
+
+	stat_test* clone() const { return new gap_test(m_bits, (int)m_count.size()); }
+
+	void consume(const double* u, size_t n)
+	{
+		const double alpha = ldexp(1.0, -m_bits);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (u[i] < alpha)
+			{
+				if (m_hit)
+					add_gap(m_suffix);
+				else
+					m_prefix = m_suffix;
+				m_hit = true;
+				m_suffix = 0;
+			}
+			else
+				m_suffix++;
+		}
+		m_n += n;
+	}
+
+	void merge(const stat_test& next)
+	{
+		const gap_test& b = static_cast<const gap_test&>(next);
+
+		for (size_t i = 0; i < m_count.size(); i++)
+			m_count[i] += b.m_count[i];
+		if (!b.m_hit)
+			m_suffix += b.m_suffix;
+		else
+		{
+			// the gap across the boundary of the blocks
+			if (m_hit)
+				add_gap(m_suffix + b.m_prefix);
+			else
+				m_prefix = m_suffix + b.m_prefix;
+			m_hit = true;
+			m_suffix = b.m_suffix;
+		}
+		m_n += b.m_n;
+	}
+
+	test_result result() const
+	{
+		const int	t = (int)m_count.size();
+		double		alpha = ldexp(1.0, -m_bits);
+		std::vector<double> p(t);
+		uint64_t	gaps = 0;
+
+		for (int i = 0; i < t; i++)
+		{
+			p[i] = i < t - 1 ? alpha * pow(1 - alpha, i) : pow(1 - alpha, t - 1);
+			gaps += m_count[i];
+		}
+
+		double x = chi2_statistic(m_count.data(), p.data(), t, gaps);
+
+		return make_result(x, chi2_pvalue(x, t - 1.0), m_n, "gap, [0, 2^-%d), %d classes", m_bits, t);
+	}
+
+private:
+	void add_gap(uint64_t len)
+	{
+		m_count[len < m_count.size() - 1 ? len : m_count.size() - 1]++;
+	}
+
+	int						m_bits;
+	std::vector<uint64_t>	m_count;
+	uint64_t				m_n;
+	bool					m_hit;			/* a variate of the block was in the interval */
+	uint64_t				m_prefix;		/* variates before the first of them */
+	uint64_t				m_suffix;		/* variates after the last of them (all if none) */
+};
+
+/*
+ * radix_sort
+ * Sorts the n keys of a (less than 2^bits) by their digits of 8 bits, tmp is a buffer
+ * of n keys; the result is in a
+ */
+inline void radix_sort(uint64_t* a, uint64_t* tmp, size_t n, int bits)
+{
+	const int	digit = 8, size = 1 << digit;
+	uint32_t	count[size];
+
+	for (int shift = 0; shift < bits; shift += digit)
+	{
+		size_t i, sum = 0;
+
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < n; i++)
+			count[(a[i] >> shift) & (size - 1)]++;
+		for (i = 0; i < (size_t)size; i++)
+		{
+			size_t c = count[i];
+			count[i] = (uint32_t)sum;
+			sum += c;
+		}
+		for (i = 0; i < n; i++)
+			tmp[count[(a[i] >> shift) & (size - 1)]++] = a[i];
+		std::swap(a, tmp);
+	}
+	// an odd number of passes left the keys in tmp
+	if (((bits + digit - 1) / digit) & 1)
+		memcpy(tmp, a, n * sizeof(uint64_t));
+}
+
+/*
+ * radix_sort_large
+ * radix_sort for arrays larger than the caches: one pass distributes the keys by their top
+ * 12 bits into buckets of about n / 4096 keys, which are sorted in the cache by radix_sort
+ * (three times faster than radix_sort on the 2^22 days of birthday spacings); the result is in a.
+ * Arrays of up to 2^16 keys are sorted by radix_sort directly.
+ */
+inline void radix_sort_large(uint64_t* a, uint64_t* tmp, size_t n, int bits)
+{
+	const int	top = bits < 12 ? bits : 12, shift = bits - top;
+	const size_t size = (size_t)1 << top;
+	std::vector<size_t> start(size + 1, 0), next;
+	size_t		i;
+
+	if (n <= (1 << 16))
+	{
+		radix_sort(a, tmp, n, bits);
+		return;
+	}
+	for (i = 0; i < n; i++)
+		start[(a[i] >> shift) + 1]++;
+	for (i = 0; i < size; i++)
+		start[i + 1] += start[i];
+	next.assign(start.begin(), start.end() - 1);
+	for (i = 0; i < n; i++)
+		tmp[next[a[i] >> shift]++] = a[i];
+	for (i = 0; i < size; i++)
+		radix_sort(tmp + start[i], a + start[i], start[i + 1] - start[i], shift);
+	memcpy(a, tmp, n * sizeof(uint64_t));
+}
+
+/*
+ * replicated_test
+ * A test made of replications of npoints points in dimension t: the points are made
+ * of t consecutive variates, store() is called with the variates as they come (fill
+ * is the number of variates of the replication before them), and evaluate() when the
+ * npoints points are complete. The blocks are whole replications. The statistic is
+ * the sum of the counts of the replications; with no replication at all the result
+ * is marked as skipped.
+ */
+class replicated_test : public stat_test
+{
+public:
+	replicated_test(int t, int npoints) : m_t(t), m_npoints(npoints), m_n(0), m_count(0), m_reps(0), m_fill(0) {}
+
+	void consume(const double* u, size_t n)
+	{
+		const size_t size = (size_t)m_t * m_npoints;
+
+		m_n += n;
+		while (n)
+		{
+			size_t k = n < size - m_fill ? n : size - m_fill;
+
+			store(u, m_fill, k);
+			m_fill += k;
+			u += k;
+			n -= k;
+			if (m_fill == size)
+			{
+				m_count += evaluate();
+				m_reps++;
+				m_fill = 0;
+			}
+		}
+	}
+
+	void finish()
+	{
+		m_fill = 0;
+	}
+
+	/* the smallest multiple of the replication not below BCN_TEST_BLOCK */
+	uint64_t block_size() const
+	{
+		const uint64_t size = (uint64_t)m_t * m_npoints;
+
+		return (BCN_TEST_BLOCK + size - 1) / size * size;
+	}
+
+	void merge(const stat_test& next)
+	{
+		const replicated_test& b = static_cast<const replicated_test&>(next);
+
+		m_n += b.m_n;
+		m_count += b.m_count;
+		m_reps += b.m_reps;
+	}
+
+protected:
+	virtual void	 store(const double* u, size_t fill, size_t n) = 0;
+	virtual uint64_t evaluate() = 0;
+
+	int						m_t, m_npoints;
+	uint64_t				m_n;
+	uint64_t				m_count;		/* total over the replications */
+	uint64_t				m_reps;
+	size_t					m_fill;			/* variates of the current replication */
+};
+
+/*
+ * birthday_test
+ * Birthday spacings: npoints birthdays in d = 2^(bits t) days (bits t <= 64), a day being
+ * the t coordinates of a point truncated to bits bits. The number of collisions of the
+ * spacings between the sorted birthdays is Poisson with the mean npoints^3 / (4 d).
+ */
+class birthday_test : public replicated_test
+{
+public:
+	birthday_test(int t = 2, int bits = 31, int npoints = 1 << 22) : replicated_test(t, npoints), m_bits(bits), m_day(0) {}
+
+	stat_test* clone() const { return new birthday_test(m_t, m_bits, m_npoints); }
+
+	test_result result() const
+	{
+		double lambda = pow((double)m_npoints, 3) / 4 / ldexp(1.0, m_bits * m_t) * m_reps;
+
+		test_result r = make_result((double)m_count, poisson_pvalue(m_count, lambda), m_n,
+									"birthday spacings, t = %d, %d bits", m_t, m_bits);
+		r.skipped = m_reps == 0;
+		return r;
+	}
+
+protected:
+	/* the variates are the digits of the days, the point fill / t is the day being made */
+	void store(const double* u, size_t fill, size_t n)
+	{
+		const double	scale = ldexp(1.0, m_bits);
+		size_t			c = fill % m_t, d = fill / m_t;
+
+		if (m_days.empty())
+			m_days.resize(2 * (size_t)m_npoints);
+		for (size_t i = 0; i < n; i++)
+		{
+			m_day = (m_day << m_bits) | (uint64_t)(u[i] * scale);
+			if (++c == (size_t)m_t)
+			{
+				m_days[d++] = m_day;
+				m_day = 0;
+				c = 0;
+			}
+		}
+	}
+
+	uint64_t evaluate()
+	{
+		const int		bits = m_bits * m_t;
+		uint64_t		collisions = 0;
+		int				i, n = m_npoints;
+
+		uint64_t* b = m_days.data();
+		radix_sort_large(b, b + n, n, bits);
+
+		// the spacings, the last one around the circle of days
+		uint64_t first = b[0], largest;
+		for (i = 0; i < n - 1; i++)
+			b[i] = b[i + 1] - b[i];
+		b[n - 1] = (bits < 64 ? (uint64_t)1 << bits : 0) - b[n - 1] + first;
+
+		// the spacings are about d / n, usually fewer digits than the days
+		for (largest = 0, i = 0; i < n; i++)
+			largest |= b[i];
+		radix_sort_large(b, b + n, n, 64 - __builtin_clzll(largest));
+		for (i = 1; i < n; i++)
+			collisions += b[i] == b[i - 1];
+		return collisions;
+	}
+
+	void finish()
+	{
+		replicated_test::finish();
+		std::vector<uint64_t>().swap(m_days);
+		m_day = 0;
+	}
+
+private:
+	int						m_bits;
+	std::vector<uint64_t>	m_days;			/* the days and the buffer of radix_sort */
+	uint64_t				m_day;			/* the digits of a day split by the chunks */
+};
+
+/*
+ * close_pairs_test
+ * Closed pairs: the number of pairs of npoints points in the unit torus of dimension t
+ * closer than r, Poisson with the mean npoints (npoints - 1) / 2 V_t(r), r chosen so
+ * that the mean is lambda per replication. The points are sorted into npoints slices
+ * of the first coordinate, and only the points of the next m_slices slices (around
+ * the torus) can be closer than r.
+ */
+class close_pairs_test : public replicated_test
+{
+public:
+	close_pairs_test(int t = 3, int npoints = 1 << 12, double lambda = 2)
+		: replicated_test(t, npoints), m_lambda(lambda)
+	{
+		// V_t(r) = pi^(t/2) r^t / Gamma(t/2 + 1)
+		double unit = pow(M_PI, t / 2.0) / tgamma(t / 2.0 + 1);
+		m_r = pow(lambda / (npoints * (npoints - 1.0) / 2) / unit, 1.0 / t);
+		m_slices = (int)(m_r * npoints) + 1;		// a pair is not counted twice if 2 m_slices < npoints
+	}
+
+	stat_test* clone() const { return new close_pairs_test(m_t, m_npoints, m_lambda); }
+
+	test_result result() const
+	{
+		test_result r = make_result((double)m_count, poisson_pvalue(m_count, m_lambda * m_reps), m_n,
+									"close pairs, t = %d, %d points", m_t, m_npoints);
+		r.skipped = m_reps == 0;
+		return r;
+	}
+
+protected:
+	void store(const double* u, size_t fill, size_t n)
+	{
+		if (m_points.empty())
+			m_points.resize((size_t)m_t * m_npoints);
+		memcpy(&m_points[fill], u, n * sizeof(double));
+	}
+
+	uint64_t evaluate()
+	{
+		const double*	p = m_points.data();
+		const int		n = m_npoints, t = m_t;
+		const double	r2 = m_r * m_r;
+		uint64_t		pairs = 0;
+		int				i, j;
+
+		// counting sort by the slice
+		m_start.assign(n + 1, 0);
+		m_slice.resize(n);
+		m_sorted.resize((size_t)n * t);
+		for (i = 0; i < n; i++)
+			m_start[(int)(p[i * t] * n) + 1]++;
+		for (i = 0; i < n; i++)
+			m_start[i + 1] += m_start[i];
+		for (i = 0; i < n; i++)
+		{
+			int s = (int)(p[i * t] * n), k = m_start[s]++;
+
+			memcpy(&m_sorted[(size_t)k * t], p + i * t, t * sizeof(double));
+			m_slice[k] = s;
+		}
+
+		const double* q = m_sorted.data();
+		for (i = 0; i < n; i++)
+		{
+			const double*	a = q + (size_t)i * t;
+			int				last = m_slice[i] + m_slices;
+
+			for (j = i + 1; j < n && m_slice[j] <= last; j++)
+				pairs += close(a, q + (size_t)j * t, r2);
+			for (j = 0; j < n && m_slice[j] + n <= last; j++)
+				pairs += close(a, q + (size_t)j * t, r2);
+		}
+		return pairs;
+	}
+
+	void finish()
+	{
+		replicated_test::finish();
+		std::vector<double>().swap(m_points);
+		std::vector<int>().swap(m_start);
+		std::vector<int>().swap(m_slice);
+		std::vector<double>().swap(m_sorted);
+	}
+
+private:
+	/* the distance on the torus is less than r */
+	bool close(const double* a, const double* b, double r2) const
+	{
+		double d2 = 0;
+
+		for (int k = 0; k < m_t; k++)
+		{
+			double d = fabs(a[k] - b[k]);
+
+			d = std::min(d, 1 - d);				// no branch, it is unpredictable
+			d2 += d * d;
+		}
+		return d2 < r2;
+	}
+
+	double				m_lambda, m_r;
+	int					m_slices;
+	std::vector<double>	m_points;			/* the coordinates of the current replication */
+	std::vector<int>	m_start, m_slice;	/* the first point of each slice, the slice of each point */
+	std::vector<double>	m_sorted;			/* the points in the order of the slices */
+};
+
+
+/* ========================= the driver ========================= */
+
+/* the engines that can be tested */
+enum test_engine { TEST_BCN = 0, TEST_SCALAR, TEST_MULTISTEP, TEST_COMBINED, TEST_COMBINED53, TEST_ENGINES };
+
+inline const char* test_engine_name(test_engine e)
+{
+	static const char* names[] = { "bcn", "scalar", "multistep", "combined", "combined53" };
+	return names[e];
+}
+
+/*
+ * default_tests
+ * The battery run by bcnrand_quality: about 120 ns per variate on one core, a third of it in
+ * birthday spacings in t = 2, which the bcn generator fails and the combined one passes from
+ * 2^23 variates (one replication) on
+ */
+inline std::vector<stat_test*> default_tests()
+{
+	std::vector<stat_test*> tests;
+
+	tests.push_back(new chi2_test(12));
+	tests.push_back(new serial_test(6));
+	tests.push_back(new gap_test(3, 64));
+	tests.push_back(new birthday_test(2, 31, 1 << 22));
+	tests.push_back(new birthday_test(8, 5, 1 << 16));
+	tests.push_back(new close_pairs_test(2, 1 << 12, 2));
+	tests.push_back(new close_pairs_test(3, 1 << 12, 2));
+	return tests;
+}
+
+inline void delete_tests(std::vector<stat_test*>& tests)
+{
+	for (size_t i = 0; i < tests.size(); i++)
+		delete tests[i];
+	tests.clear();
+}
+
+/*
+ * test_block
+ * Generates the variates first, ..., first + len - 1 of the sequence starting at position
+ * with the engine, chunk by chunk, and passes them to the accumulators
+ */
+inline void test_block(test_engine engine, uint64_t position, uint64_t first, uint64_t len, stat_test** acc, size_t ntests)
+{
+	alignas(64) double	u[BCN_TEST_CHUNK];
+	uint64_t			s, s1 = 0;
+
+	if (engine == TEST_COMBINED || engine == TEST_COMBINED53)
+		seed_combined(position, first, &s, &s1);
+	else
+		s = BarrettInitBit(position + 53 * first);
+
+	while (len)
+	{
+		size_t n = (size_t)(len < BCN_TEST_CHUNK ? len : BCN_TEST_CHUNK);
+
+		switch (engine)
+		{
+		case TEST_SCALAR:		generate(s, u, n, kernel_scalar<double>); break;
+		case TEST_MULTISTEP:	generate_multistep(s, u, n); break;
+		case TEST_COMBINED:		generate_combined(s, s1, u, n); break;
+		case TEST_COMBINED53:	generate_combined<53>(s, s1, u, n); break;
+		default:				generate(s, u, n); break;
+		}
+		for (size_t k = 0; k < ntests; k++)
+			acc[k]->consume(u, n);
+		len -= n;
+	}
+	for (size_t k = 0; k < ntests; k++)
+		acc[k]->finish();
+}
+
+/*
+ * run_blocks
+ * Runs the tests (all of the same block_size()) on the n variates of the sequence starting
+ * at position, in parallel
+ */
+inline void run_blocks(std::vector<stat_test*>& tests, test_engine engine, uint64_t n, uint64_t position)
+{
+	const size_t	ntests = tests.size();
+	const uint64_t	block = tests[0]->block_size();
+	const uint64_t	nblocks = (n + block - 1) / block;
+	const uint64_t	wave = 2 * default_pool().size();		/* blocks accumulated at once */
+	std::vector<stat_test*> acc(wave * ntests);
+
+	for (uint64_t b0 = 0; b0 < nblocks; b0 += wave)
+	{
+		unsigned int nb = (unsigned int)(nblocks - b0 < wave ? nblocks - b0 : wave);
+
+		for (unsigned int b = 0; b < nb; b++)
+			for (size_t k = 0; k < ntests; k++)
+				acc[b * ntests + k] = tests[k]->clone();
+
+		default_pool().run(nb, [&](unsigned int b)
+		{
+			uint64_t first = (b0 + b) * block;
+
+			test_block(engine, position, first, first + block < n ? block : n - first, &acc[b * ntests], ntests);
+		});
+
+		// in the order of the blocks
+		for (unsigned int b = 0; b < nb; b++)
+			for (size_t k = 0; k < ntests; k++)
+			{
+				tests[k]->merge(*acc[b * ntests + k]);
+				delete acc[b * ntests + k];
+			}
+	}
+}
+
+/*
+ * run_tests
+ * Runs the tests on the n variates of the sequence starting at position, in parallel,
+ * one pass over the sequence for each block size of the tests.
+ * The tests accumulate their statistics: run_tests can be called again with the next
+ * position (position + 53 n) to continue the sequence.
+ * Parameters:
+ *	tests:		input/output, the accumulators of the tests, e.g. default_tests()
+ *	engine:		input, the engine generating the sequence
+ *	n:			input, number of variates
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ */
+inline void run_tests(std::vector<stat_test*>& tests, test_engine engine, uint64_t n, uint64_t position)
+{
+	std::vector<bool>	done(tests.size(), false);
+
+	for (size_t i = 0; i < tests.size(); i++)
+	{
+		std::vector<stat_test*> group;
+
+		for (size_t k = i; k < tests.size(); k++)
+			if (!done[k] && tests[k]->block_size() == tests[i]->block_size())
+			{
+				group.push_back(tests[k]);
+				done[k] = true;
+			}
+		if (!group.empty())
+			run_blocks(group, engine, n, position);
+	}
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_QUALITY_H
@@ -0,0 +1,203 @@
+/* ************************************************************************** */
+/* * bcnrand_sched.h                                                        * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Deterministic dynamic scheduling of the sequence. With the static
+	partition of Kernel_initGenerator (workPerThread elements per thread) a
+	thread whose samples take longer, e.g. in rejection sampling, keeps the
+	others waiting. Here the sequence is cut in nchunks chunks of chunk
+	elements, chunk i always starts at the position
+		position + 53 i chunk
+	(BarrettInitBit, as Kernel_initGenerator with workPerThread = chunk),
+	and the chunks are run by the threads of the pool with work stealing:
+	every thread starts with a contiguous range of chunks in its own deque,
+	takes them from the back, and when it has none left steals from the
+	front of the deques of the others. The deques only hold ranges of chunk
+	indices, so they are two atomic counters each (the deque of Chase and
+	Lev without pushes), lock free.
+
+	The chunk i sees the same variates whichever thread runs it, and
+	chunked_reduce combines the results of the chunks in the order of i
+	(the tree of bcn::monte_carlo), so the result is bit for bit the same
+	for any number of threads and any stealing.
+
+	A chunk should draw at most chunk variates: the next ones are those of
+	the chunk i+1 (the result is still reproducible, but the chunks overlap).
+	The generator of a chunk is seeded with seed(position, chunk), so its
+	first refill only generates min(chunk, BCN_BUFFER_SIZE) variates and
+	small chunks do not pay for a whole buffer.
+
+	Usage:
+			// accepted samples of an irregular rejection method, chunks of 4096 draws
+			uint64_t n = bcn::chunked_reduce(nchunks, 4096, seed,
+				[](uint64_t i, bcn::buffered_generator<>& g) { ... return accepted; },
+				std::plus<uint64_t>());
+
+			// or per chunk output, e.g. out[i] = f(chunk i)
+			bcn::chunked_for(nchunks, 4096, seed, [&](uint64_t i, bcn::buffered_generator<>& g) { ... });
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_SCHED_H
+#define BCNRAND_SCHED_H
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "bcnrand_buffer.h"
+#include "bcnrand_montecarlo.h"
+
+namespace bcn {
+
+/*
+ * chunk_deque
+ * The chunks [top, bottom) of a thread. The owner takes the last one (pop), the other threads
+ * the first one (steal); only the last chunk is contended, and is given to one of them by the
+ * compare and swap of top.
+ */
+struct alignas(64) chunk_deque
+{
+	std::atomic<int64_t>	top;
+	std::atomic<int64_t>	bottom;
+
+	/* the owner: the last chunk in *i, false if empty */
+	bool pop(int64_t* i)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		int64_t t;
+
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		*i = b;
+		if (t == b)
+		{
+			// the last chunk, a thief may take it first
+			bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	/* the other threads: the first chunk in *i, false if empty or taken by another thread */
+	bool steal(int64_t* i)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return false;
+		*i = t;
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	bool empty() const
+	{
+		return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+	}
+};
+
+/*
+ * chunked_for
+ * Calls f(i, g) for the chunks i = 0..nchunks-1 in parallel with work stealing, g is a buffered
+ * generator of the thread seeded at the position of the chunk for chunk draws (see above)
+ * Parameters:
+ *	nchunks:	input, number of chunks
+ *	chunk:		input, elements of the sequence per chunk
+ *	position:	input, starting position (the seed of Kernel_initGenerator)
+ *	f:			input, the work of a chunk, called concurrently by the threads
+ *	nthreads:	input, number of threads (deques), 0 for the size of the default pool
+ */
+template <class T = double, class F>
+inline void chunked_for(uint64_t nchunks, uint64_t chunk, uint64_t position, F f, unsigned int nthreads = 0)
+{
+	const unsigned int	w = nthreads ? nthreads : default_pool().size();
+	chunk_deque*		q = (chunk_deque*)aligned_alloc(alignof(chunk_deque), w * sizeof(chunk_deque));
+	unsigned int		k;
+
+	// thread k starts with the chunks [k nchunks / w, (k+1) nchunks / w)
+	for (k = 0; k < w; k++)
+	{
+		new (q + k) chunk_deque;
+		q[k].top.store((int64_t)(nchunks * k / w), std::memory_order_relaxed);
+		q[k].bottom.store((int64_t)(nchunks * (k + 1) / w), std::memory_order_relaxed);
+	}
+
+	default_pool().run(w, [&](unsigned int me)
+	{
+		buffered_generator<T> g;
+		int64_t		i;
+		unsigned int v;
+		bool		stolen;
+
+		for (;;)
+		{
+			while (q[me].pop(&i))
+			{
+				g.seed(position + 53 * (uint64_t)i * chunk, chunk);
+				f((uint64_t)i, g);
+			}
+
+			// steal one chunk, starting with the deque of the next thread
+			stolen = false;
+			for (v = 1; v < w && !stolen; v++)
+			{
+				chunk_deque& d = q[(me + v) % w];
+
+				while (!stolen && !d.empty())
+					stolen = d.steal(&i);
+			}
+			// no chunk is added, so all of them are taken
+			if (!stolen)
+				return;
+
+			g.seed(position + 53 * (uint64_t)i * chunk, chunk);
+			f((uint64_t)i, g);
+		}
+	});
+	free(q);
+}
+
+/*
+ * chunked_reduce
+ * Reduces the results f(i, g) of the chunks i = 0..nchunks-1 (chunked_for) in the order of i,
+ * with the same result for any number of threads
+ * Parameters:
+ *	nchunks, chunk, position, nthreads:	as in chunked_for
+ *	f:			input, the result of a chunk
+ *	reduce:		input, the associative reduction of two results
+ *	identity:	input, the identity of reduce
+ */
+template <class T = double, class F, class Reducer,
+		  class Result = typename std::decay<decltype(std::declval<F&>()(uint64_t(), std::declval<buffered_generator<T>&>()))>::type>
+inline Result chunked_reduce(uint64_t nchunks, uint64_t chunk, uint64_t position, F f, const Reducer& reduce,
+							 const Result& identity = Result(), unsigned int nthreads = 0)
+{
+	// not a std::vector: the chunks write their results concurrently, which vector<bool> does not allow
+	std::unique_ptr<Result[]> r(new Result[(size_t)nchunks]);
+
+	chunked_for<T>(nchunks, chunk, position, [&](uint64_t i, buffered_generator<T>& g) { r[(size_t)i] = f(i, g); }, nthreads);
+
+	pairwise<Result, Reducer> tree(reduce);
+	for (uint64_t i = 0; i < nchunks; i++)
+		tree.add(r[(size_t)i]);
+	return tree.result(identity);
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_SCHED_H
@@ -0,0 +1,314 @@
+/* ************************************************************************** */
+/* * bcnrand_shm.h                                                          * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Random number service in POSIX shared memory. One producer
+	(bcnrand_shmd.cpp) generates the sequence with all the cores given to it
+	and writes it in a ring of blocks of a shared memory segment; any number
+	of consumer processes map the segment and take whole blocks, in place,
+	without a copy and without a system call on the fast path.
+
+	The sequence starting at position is cut in blocks of block variates:
+	block k holds the elements k block, ..., (k+1) block - 1, the same numbers
+	as bcn::fill(x, block, position + 53 k block), and is tagged with that
+	position. It is written to the slot k mod nslots of the ring. A consumer
+	claims the next block with an atomic increment of the shared cursor, so
+	every block goes to exactly one consumer, waits until the producer has
+	published it, reads it and releases it; the producer only overwrites a
+	slot after the block in it has been released. A consumer that claims a
+	block and never releases it stops the producer when the ring comes back
+	to its slot.
+
+	The blocks a consumer gets depend on the order of the claims, but every
+	block carries its index and position, so a result computed from a block
+	can be reproduced with bcn::fill from the position, or by giving the
+	block to the same computation again.
+
+	Layout of the segment: shm_header, then the nslots shm_slot, then the
+	variates of the slots from an offset aligned to a page. The atomics are
+	64 bit and lock free, so they work across processes.
+
+	Usage:
+			bcn::shm_client c;
+			bcn::shm_block b;
+
+			if (c.open() == 0 && c.format() == bcn::SHM_DOUBLE)
+				while (c.claim(b))
+				{
+					const double* x = b.as<double>();	// b.count variates, element b.index * c.block_size()
+					...
+					c.release(b);
+				}
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_SHM_H
+#define BCNRAND_SHM_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "bcnrand_shm.h needs lock free 64 bit atomics"
+#endif
+
+namespace bcn {
+
+static const char* const	BCN_SHM_NAME = "/bcnrand";						/* default name of the segment */
+static const uint64_t		BCN_SHM_MAGIC = 0x31646e61726e6362ULL;			/* "bcnrand1" */
+
+/* the format of the variates, as in bcnrand_stream */
+enum shm_format { SHM_DOUBLE, SHM_FLOAT, SHM_U32, SHM_RAW };
+
+static const uint32_t		shm_format_sizes[] = { sizeof(double), sizeof(float), sizeof(uint32_t), sizeof(uint64_t) };
+
+/*
+ * shm_slot
+ * The state of a slot of the ring; ready and done are k + 1 for the block k (0 for none yet)
+ */
+struct alignas(64) shm_slot
+{
+	std::atomic<uint64_t>	ready;			/* the last block published in the slot */
+	std::atomic<uint64_t>	done;			/* the last block released by its consumer */
+	uint64_t				position;		/* position of the first element of the block */
+};
+
+/*
+ * shm_header
+ * The beginning of the segment, written by the producer before magic
+ */
+struct alignas(64) shm_header
+{
+	std::atomic<uint64_t>	magic;
+	uint32_t				format;			/* shm_format */
+	uint32_t				size;			/* bytes per variate */
+	uint64_t				block;			/* variates per block */
+	uint64_t				nslots;			/* blocks in the ring */
+	uint64_t				position;		/* position of the element 0 of block 0 */
+	uint64_t				data;			/* offset of the variates of slot 0 */
+	uint64_t				bytes;			/* size of the segment */
+
+	alignas(64) std::atomic<uint64_t>	cursor;		/* the next block to claim */
+	alignas(64) std::atomic<uint64_t>	produced;	/* blocks published */
+	std::atomic<uint32_t>				closed;		/* the producer has stopped */
+};
+
+inline shm_slot* shm_slots(shm_header* h)
+{
+	return (shm_slot*)(h + 1);
+}
+
+inline char* shm_data(shm_header* h, uint64_t k)
+{
+	return (char*)h + h->data + (k % h->nslots) * h->block * h->size;
+}
+
+/*
+ * shm_backoff
+ * Waiting of the producer and the consumers: spins first, then yields the core, then sleeps
+ * 50 microseconds at a time
+ */
+class shm_backoff
+{
+public:
+	shm_backoff() : m_count(0) {}
+
+	void wait()
+	{
+		if (m_count < 64)
+			_mm_pause();
+		else if (m_count < 128)
+			sched_yield();
+		else
+		{
+			struct timespec t = { 0, 50000 };
+			nanosleep(&t, 0);
+		}
+		m_count++;
+	}
+
+private:
+	unsigned int	m_count;
+};
+
+/*
+ * shm_create
+ * Creates (or replaces) the segment name for a ring of nslots blocks of block variates of
+ * the sequence starting at position, and maps it; returns 0 and sets *header, or errno
+ */
+inline int shm_create(const char* name, shm_format format, uint64_t block, uint64_t nslots, uint64_t position,
+					  shm_header** header)
+{
+	const uint64_t	page = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t		data = (sizeof(shm_header) + nslots * sizeof(shm_slot) + page - 1) / page * page;
+	uint64_t		bytes = data + nslots * block * shm_format_sizes[format];
+	int				fd, err;
+	void*			p;
+
+	shm_unlink(name);
+	if ((fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0)
+		return errno;
+	if (ftruncate(fd, (off_t)bytes) != 0)
+	{
+		err = errno;
+		close(fd);
+		shm_unlink(name);
+		return err;
+	}
+	p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	err = errno;
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		shm_unlink(name);
+		return err;
+	}
+
+	// the segment is zero filled: the slots are empty
+	shm_header* h = new (p) shm_header;
+	h->format = format;
+	h->size = shm_format_sizes[format];
+	h->block = block;
+	h->nslots = nslots;
+	h->position = position;
+	h->data = data;
+	h->bytes = bytes;
+	h->cursor.store(0, std::memory_order_relaxed);
+	h->produced.store(0, std::memory_order_relaxed);
+	h->closed.store(0, std::memory_order_relaxed);
+	for (uint64_t s = 0; s < nslots; s++)
+		new (shm_slots(h) + s) shm_slot();
+	h->magic.store(BCN_SHM_MAGIC, std::memory_order_release);
+
+	*header = h;
+	return 0;
+}
+
+/*
+ * shm_destroy
+ * Tells the consumers that the producer has stopped, unmaps and removes the segment
+ */
+inline void shm_destroy(const char* name, shm_header* h)
+{
+	h->closed.store(1, std::memory_order_release);
+	munmap(h, h->bytes);
+	shm_unlink(name);
+}
+
+/*
+ * shm_block
+ * A block claimed by a consumer: count variates of the format of the ring, the elements
+ * index * count, ... of the sequence, starting at position
+ */
+struct shm_block
+{
+	const void*	data;
+	uint64_t	count;
+	uint64_t	index;
+	uint64_t	position;
+
+	template <class T>
+	const T* as() const { return (const T*)data; }
+};
+
+/*
+ * shm_client
+ * The consumer side of the ring; one client per thread (the blocks of different clients, in
+ * the same or in different processes, never overlap)
+ */
+class shm_client
+{
+public:
+	shm_client() : m_header(0) {}
+
+	~shm_client() { close(); }
+
+	/* maps the segment name, returns 0 or errno (EPROTO if it is not a ring of this version) */
+	int open(const char* name = BCN_SHM_NAME)
+	{
+		struct stat	st;
+		int			fd, err = 0;
+		void*		p;
+
+		close();
+		if ((fd = shm_open(name, O_RDWR, 0)) < 0)
+			return errno;
+		if (fstat(fd, &st) != 0)
+			err = errno;
+		else if ((size_t)st.st_size < sizeof(shm_header))
+			err = EPROTO;
+		else if ((p = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+			err = errno;
+		else
+		{
+			m_header = (shm_header*)p;
+			if (m_header->magic.load(std::memory_order_acquire) != BCN_SHM_MAGIC ||
+				m_header->bytes != (uint64_t)st.st_size)
+			{
+				munmap(p, (size_t)st.st_size);
+				m_header = 0;
+				err = EPROTO;
+			}
+		}
+		::close(fd);
+		return err;
+	}
+
+	void close()
+	{
+		if (m_header)
+			munmap(m_header, m_header->bytes);
+		m_header = 0;
+	}
+
+	shm_format format() const { return (shm_format)m_header->format; }
+	uint64_t block_size() const { return m_header->block; }
+	uint64_t position() const { return m_header->position; }
+
+	/* claims the next block and waits until it is published; false if the producer has stopped */
+	bool claim(shm_block& b)
+	{
+		const uint64_t	k = m_header->cursor.fetch_add(1, std::memory_order_relaxed);
+		shm_slot&		s = shm_slots(m_header)[k % m_header->nslots];
+		shm_backoff		backoff;
+
+		while (s.ready.load(std::memory_order_acquire) != k + 1)
+		{
+			if (m_header->closed.load(std::memory_order_acquire))
+				return false;
+			backoff.wait();
+		}
+		b.data = shm_data(m_header, k);
+		b.count = m_header->block;
+		b.index = k;
+		b.position = s.position;
+		return true;
+	}
+
+	/* gives the slot of the block back to the producer */
+	void release(const shm_block& b)
+	{
+		shm_slots(m_header)[b.index % m_header->nslots].done.store(b.index + 1, std::memory_order_release);
+	}
+
+private:
+	shm_header*		m_header;
+};
+
+} // namespace bcn
+
+#endif // BCNRAND_SHM_H
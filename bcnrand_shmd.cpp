@@ -0,0 +1,149 @@
+/* ************************************************************************** */
+/* * bcnrand_shmd.cpp                                                       * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*
+ * Producer of the shared memory random number service (bcnrand_shm.h): generates the blocks
+ * of the sequence into the ring of the segment until it is stopped (SIGINT or SIGTERM), then
+ * removes the segment.
+ *
+ * Call from the command line:  ./bcnrand_shmd -s /bcnrand -f double -b 65536 -k 64 -p 112
+ *	-s name:		name of the segment (default /bcnrand)
+ *	-f format:		double (default), float, u32 or raw, as in bcnrand_stream
+ *	-b count:		variates per block (default 65536)
+ *	-k count:		blocks in the ring (default 64)
+ *	-p position:	starting position of the sequence (default 112)
+ *
+ * The free slots are filled in batches of up to BCNRAND_THREADS blocks, one block per thread
+ * of the pool, and published in order. The cores of the producer are chosen with taskset
+ * (and BCNRAND_THREADS), e.g. taskset -c 0-3 env BCNRAND_THREADS=4 ./bcnrand_shmd
+ *
+ *	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bcnrand_fill.h"
+#include "bcnrand_shm.h"
+
+using namespace bcn;
+
+static const char*	format_names[] = { "double", "float", "u32", "raw" };
+
+static volatile sig_atomic_t	stop = 0;
+
+static void on_signal(int)
+{
+	stop = 1;
+}
+
+/* block k of the ring, one thread */
+template <class T>
+void generate_block(shm_header* h, uint64_t k)
+{
+	fill((T*)shm_data(h, k), h->block, h->position + 53 * k * h->block, (lanes_kernel_t<T>)0, 1);
+}
+
+static void generate_block(shm_header* h, uint64_t k)
+{
+	switch (h->format)
+	{
+	case SHM_FLOAT:	generate_block<float>(h, k); break;
+	case SHM_U32:	generate_block<uint32_t>(h, k); break;
+	case SHM_RAW:	generate_block<uint64_t>(h, k); break;
+	default:		generate_block<double>(h, k); break;
+	}
+}
+
+/* the slot of block k is free: empty, or its previous block has been released */
+static bool slot_free(shm_header* h, uint64_t k)
+{
+	return k < h->nslots || shm_slots(h)[k % h->nslots].done.load(std::memory_order_acquire) == k - h->nslots + 1;
+}
+
+static void produce(shm_header* h)
+{
+	const uint64_t	batch = default_pool().size();
+	uint64_t		k = 0, m;
+
+	while (!stop)
+	{
+		shm_backoff backoff;
+
+		while (!slot_free(h, k))
+		{
+			if (stop)
+				return;
+			backoff.wait();
+		}
+		for (m = 1; m < batch && m < h->nslots && slot_free(h, k + m); m++)
+			;
+
+		default_pool().run((unsigned int)m, [&](unsigned int i) { generate_block(h, k + i); });
+
+		for (uint64_t i = k; i < k + m; i++)
+		{
+			shm_slot& s = shm_slots(h)[i % h->nslots];
+
+			s.position = h->position + 53 * i * h->block;
+			s.ready.store(i + 1, std::memory_order_release);
+		}
+		k += m;
+		h->produced.store(k, std::memory_order_release);
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	const char*		name = BCN_SHM_NAME;
+	shm_format		format = SHM_DOUBLE;
+	uint64_t		block = 65536, nslots = 64, position = 112;
+	shm_header*		h;
+	int				c, err;
+
+	while ((c = getopt(argc, argv, "s:f:b:k:p:")) != -1)
+	{
+		switch (c)
+		{
+		case 's':	name = optarg; break;
+		case 'f':
+			for (c = SHM_DOUBLE; c <= SHM_RAW; c++)
+				if (strcmp(optarg, format_names[c]) == 0)
+					break;
+			if (c > SHM_RAW)
+				goto usage;
+			format = (shm_format)c;
+			break;
+		case 'b':	block = strtoull(optarg, 0, 10); break;
+		case 'k':	nslots = strtoull(optarg, 0, 10); break;
+		case 'p':	position = strtoull(optarg, 0, 10); break;
+		default:	goto usage;
+		}
+	}
+	if (optind != argc || block == 0 || nslots == 0)
+		goto usage;
+
+	if ((err = shm_create(name, format, block, nslots, position, &h)) != 0)
+	{
+		fprintf(stderr, "bcnrand_shmd: %s: %s\n", name, strerror(err));
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	produce(h);
+
+	shm_destroy(name, h);
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage ./bcnrand_shmd [-s name] [-f double|float|u32|raw] [-b block] [-k slots] [-p position]\n");
+	return 1;
+}
@@ -0,0 +1,851 @@
+/* ************************************************************************** */
+/* * bcnrand_simd.h                                                         * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Vectorised host version of the bcn generator. The kernels advance a block
+	of BCN_LANES independent states at once, 4 per instruction with AVX2 and 8
+	per instruction with AVX-512 IFMA, and convert them to double with vector
+	instructions. A third kernel (FMA) does the same arithmetic in double
+	precision with fused multiply-adds, for CPUs with AVX2 but without IFMA.
+	The kernel is chosen at run time (CPUID), so the same binary
+	runs on every x86-64 CPU. All kernels give exactly the same numbers as the
+	scalar code in bcnrand_host.h.
+
+	Every lane is multiplied by the same constant c mod 3^33 at each step,
+	using Shoup's modular multiplication with the precomputed quotient
+	floor(c 2^64 / 3^33). With c = 2^53 the lanes are independent bcn streams;
+	with c = 2^(53 BCN_LANES) and lane j started j steps ahead, the block
+	produces consecutive elements of one sequence (see generate below).
+
+	The kernels are not ranked by their instruction sets: which one is the
+	fastest depends on the CPU (the AVX2 kernel can be slower than the scalar
+	one, which has fewer 64 bit products to emulate). At the first call,
+	bcn::generate times every kernel the CPU supports and generate_multistep
+	on a few thousand numbers and keeps the fastest (calibrate_generate);
+	since all of them give the same numbers, the choice only changes the
+	speed. The kernel can be forced to a lower instruction set, without the
+	measurement, by the environment variable
+	BCNRAND_ISA=scalar|avx2|fma|avx512ifma.
+
+	Usage:
+			uint64_t state = bcn::BarrettInitBit(seed);
+			bcn::generate(state, x, n);		// same as n calls of bcnrandom_inline
+
+		The kernels can also write float, uint32_t, the fixed point q32 or the
+		raw states (uint64_t) instead of doubles, see the kernel signature.
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_SIMD_H
+#define BCNRAND_SIMD_H
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+#include "bcnrand_host.h"
+#include "bcnrand_kernel.h"
+
+namespace bcn {
+
+static const int BCN_LANES = 64;				/* states advanced together by a kernel */
+
+/*
+ * multiplier
+ * Constant multiplier c of the kernels with its precomputed quotients
+ *	cs  = floor(c 2^64 / 3^33)	(Shoup, used by the scalar and AVX2 kernels)
+ *	c52 = floor(c 2^52 / 3^33)	(used by the AVX-512 IFMA kernel)
+ */
+struct multiplier
+{
+	uint64_t	c;
+	uint64_t	cs;
+	uint64_t	c52;
+};
+
+inline multiplier make_multiplier(uint64_t c)
+{
+	multiplier a;
+
+	a.c   = c % BCN_m;
+	a.cs  = (uint64_t)(((uint128_t)a.c << 64) / BCN_m);
+	a.c52 = (uint64_t)(((uint128_t)a.c << 52) / BCN_m);
+	return a;
+}
+
+/*
+ * MulModStep
+ * Returns z c mod 3^33 for z < 2^64 (Shoup's method, one conditional subtraction)
+ */
+inline uint64_t MulModStep(uint64_t z, const multiplier& a)
+{
+	uint64_t q = (uint64_t)(umul128(z, a.cs) >> 64);
+	uint64_t r = z * a.c - q * BCN_m;
+
+	r -= (r >= BCN_m) ? BCN_m : 0;
+	return r;
+}
+
+/*
+ * pow2_53
+ * Returns 2^(53 n) mod 3^33, the multiplier that advances the sequence by n steps
+ */
+inline uint64_t pow2_53(uint64_t n)
+{
+	return BarrettSkip(1, n);
+}
+
+/*
+ * leapfrog
+ * The multipliers c and c^BCN_LANES of a geometric progression z c^i computed by the kernels,
+ * lane j holds z c^j and is multiplied by c^BCN_LANES at each step
+ */
+struct leapfrog
+{
+	multiplier	one;
+	multiplier	leap;
+};
+
+inline leapfrog make_leapfrog(uint64_t c)
+{
+	leapfrog	p;
+	uint64_t	cl = 1;
+	int			j;
+
+	p.one = make_multiplier(c);
+	for (j = 0; j < BCN_LANES; j++)
+		cl = MulModStep(cl, p.one);
+	p.leap = make_multiplier(cl);
+	return p;
+}
+
+
+/* ============================== kernels ============================== */
+
+/*
+ * Kernel signature. For k = 0..rows-1 the kernel writes
+ *		out[k*stride + j] = z[j],	j = 0..BCN_LANES-1
+ * converted to the output type T, and then replaces z[j] by z[j] c mod 3^33.
+ * stride >= BCN_LANES is the distance between the rows of the output (BCN_LANES when
+ * the rows are contiguous, larger when several kernels fill interleaved tiles).
+ * The states z must be in [1, 3^33). The output types are
+ *		double		u = z 3^-33, the random variate on (0,1)
+ *		float		u rounded to nearest, and to 1 - 2^-24 if it would round to 1, in (0,1)
+ *		uint32_t	floor(u 2^32), uniform 32 bit integers in [0, 2^32)
+ *		q32			u in the fixed point format Q0.32: rint(u 2^32) (ties to even), clamped
+ *					to [1, 2^32 - 1], so that the value q 2^-32 is in (0,1)
+ *		uint64_t	z itself, the raw state (e.g. the seeds of Kernel_Opt)
+ * The integer formats are computed from the double u, so all the formats give the same
+ * variates as the double output, with fewer bits.
+ */
+template <class T>
+using lanes_kernel_t = void (*)(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride);
+
+typedef lanes_kernel_t<double> lanes_kernel;
+
+struct q32
+{
+	uint32_t	v;
+};
+
+static const float	BCN_float_max = 0.99999994f;			/* 1 - 2^-24, the largest float below 1 */
+static const double	BCN_2_32 = 4294967296.0;				/* 2^32 */
+static const double	BCN_q32_max = 4294967295.0;				/* 2^32 - 1 */
+
+inline void store_state(double* out, uint64_t z)	{ *out = BCN_minv * z; }
+inline void store_state(uint64_t* out, uint64_t z)	{ *out = z; }
+
+inline void store_state(float* out, uint64_t z)
+{
+	float f = (float)(BCN_minv * z);
+	*out = f < BCN_float_max ? f : BCN_float_max;
+}
+
+inline void store_state(uint32_t* out, uint64_t z)
+{
+	*out = (uint32_t)(BCN_minv * z * BCN_2_32);
+}
+
+inline void store_state(q32* out, uint64_t z)
+{
+	double q = rint(BCN_minv * z * BCN_2_32);
+	out->v = (uint32_t)(q < 1 ? 1 : (q > BCN_q32_max ? BCN_q32_max : q));
+}
+
+template <class T>
+inline void kernel_scalar(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride)
+{
+	uint64_t s[BCN_LANES];
+	int j;
+
+	memcpy(s, z, sizeof(s));
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES; j++)
+		{
+			store_state(out + j, s[j]);
+			s[j] = MulModStep(s[j], a);
+		}
+	}
+	memcpy(z, s, sizeof(s));
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BCN_HAVE_X86_KERNELS 1
+
+/* AVX2 has no 64 bit multiplication, the products are assembled from 32x32 bit ones */
+#define BCN_AVX2 __attribute__((target("avx2")))
+
+BCN_AVX2 inline __m256i mulmod_avx2(__m256i z, __m256i c, __m256i c_hi, __m256i cs, __m256i cs_hi,
+									__m256i m, __m256i m_hi, __m256i mask32)
+{
+	__m256i zh = _mm256_srli_epi64(z, 32);
+	__m256i ll, lh, hl, q, qh, t, zc, qm;
+
+	// q = mulhi(z, cs)
+	ll = _mm256_mul_epu32(z, cs);
+	lh = _mm256_mul_epu32(z, cs_hi);
+	hl = _mm256_mul_epu32(zh, cs);
+	q  = _mm256_mul_epu32(zh, cs_hi);
+	t  = _mm256_add_epi64(_mm256_srli_epi64(ll, 32), _mm256_and_si256(lh, mask32));
+	t  = _mm256_add_epi64(t, _mm256_and_si256(hl, mask32));
+	q  = _mm256_add_epi64(q, _mm256_add_epi64(_mm256_srli_epi64(lh, 32), _mm256_srli_epi64(hl, 32)));
+	q  = _mm256_add_epi64(q, _mm256_srli_epi64(t, 32));
+
+	// r = z c - q m  mod 2^64
+	qh = _mm256_srli_epi64(q, 32);
+	zc = _mm256_add_epi64(_mm256_mul_epu32(zh, c), _mm256_mul_epu32(z, c_hi));
+	zc = _mm256_add_epi64(_mm256_mul_epu32(z, c), _mm256_slli_epi64(zc, 32));
+	qm = _mm256_add_epi64(_mm256_mul_epu32(qh, m), _mm256_mul_epu32(q, m_hi));
+	qm = _mm256_add_epi64(_mm256_mul_epu32(q, m), _mm256_slli_epi64(qm, 32));
+	z  = _mm256_sub_epi64(zc, qm);
+
+	// r < 2m < 2^63, so the signed comparison is safe
+	return _mm256_sub_epi64(z, _mm256_andnot_si256(_mm256_cmpgt_epi64(m, z), m));
+}
+
+/* exact conversion of z < 2^53 to double, from the two 32 bit halves */
+BCN_AVX2 inline __m256d to_exact_double_avx2(__m256i z, __m256i mask32)
+{
+	const __m256i	lo_magic = _mm256_set1_epi64x(0x4330000000000000LL);	/* 2^52 */
+	const __m256i	hi_magic = _mm256_set1_epi64x(0x4530000000000000LL);	/* 2^84 */
+	const __m256d	hilo = _mm256_set1_pd(19342813118337666422669312.0);	/* 2^84 + 2^52 */
+
+	__m256d lo = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(z, mask32), lo_magic));
+	__m256d hi = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(z, 32), hi_magic));
+
+	return _mm256_add_pd(_mm256_sub_pd(hi, hilo), lo);
+}
+
+BCN_AVX2 inline __m256d to_double_avx2(__m256i z, __m256i mask32)
+{
+	return _mm256_mul_pd(to_exact_double_avx2(z, mask32), _mm256_set1_pd(BCN_minv));
+}
+
+BCN_AVX2 inline void store_avx2(double* out, __m256i z, __m256i mask32)
+{
+	_mm256_storeu_pd(out, to_double_avx2(z, mask32));
+}
+
+BCN_AVX2 inline void store_avx2(uint64_t* out, __m256i z, __m256i)
+{
+	_mm256_storeu_si256((__m256i*)out, z);
+}
+
+BCN_AVX2 inline void store_avx2(float* out, __m256i z, __m256i mask32)
+{
+	__m128 f = _mm256_cvtpd_ps(to_double_avx2(z, mask32));
+	_mm_storeu_ps(out, _mm_min_ps(f, _mm_set1_ps(BCN_float_max)));
+}
+
+/* x in [0, 2^32) is an integer, shifted to the signed range for the conversion */
+BCN_AVX2 inline __m128i to_uint32_avx2(__m256d x)
+{
+	__m128i i = _mm256_cvttpd_epi32(_mm256_sub_pd(x, _mm256_set1_pd(2147483648.0)));
+	return _mm_xor_si128(i, _mm_set1_epi32((int)0x80000000));
+}
+
+BCN_AVX2 inline void store_avx2(uint32_t* out, __m256i z, __m256i mask32)
+{
+	__m256d x = _mm256_mul_pd(to_double_avx2(z, mask32), _mm256_set1_pd(BCN_2_32));
+	_mm_storeu_si128((__m128i*)out, to_uint32_avx2(_mm256_floor_pd(x)));
+}
+
+BCN_AVX2 inline void store_avx2(q32* out, __m256i z, __m256i mask32)
+{
+	__m256d x = _mm256_mul_pd(to_double_avx2(z, mask32), _mm256_set1_pd(BCN_2_32));
+	x = _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(1.0)), _mm256_set1_pd(BCN_q32_max));
+	_mm_storeu_si128((__m128i*)out, to_uint32_avx2(x));
+}
+
+template <class T>
+BCN_AVX2 inline void kernel_avx2(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride)
+{
+	const __m256i	mask32 = _mm256_set1_epi64x(0xFFFFFFFFLL);
+	const __m256i	c  = _mm256_set1_epi64x(a.c),  c_hi  = _mm256_set1_epi64x(a.c >> 32);
+	const __m256i	cs = _mm256_set1_epi64x(a.cs), cs_hi = _mm256_set1_epi64x(a.cs >> 32);
+	const __m256i	m  = _mm256_set1_epi64x(BCN_m), m_hi = _mm256_set1_epi64x(BCN_m >> 32);
+	__m256i			s[BCN_LANES / 4];
+	int				j;
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+		s[j] = _mm256_loadu_si256((const __m256i*)(z + 4 * j));
+
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES / 4; j++)
+		{
+			store_avx2(out + 4 * j, s[j], mask32);
+			s[j] = mulmod_avx2(s[j], c, c_hi, cs, cs_hi, m, m_hi, mask32);
+		}
+	}
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+		_mm256_storeu_si256((__m256i*)(z + 4 * j), s[j]);
+}
+
+/*
+ * FMA: the modular multiplication in double precision, for CPUs where the 64 bit
+ * integer products of the AVX2 kernel are slow. As in the lcn macros of bcnrand.inl
+ * (LCN_Inline), the quotient is estimated in floating point and the remainder is
+ * computed exactly; here the remainder comes from fused multiply-adds, so the
+ * kernel has no integer operations at all. The states are kept as doubles (integers
+ * below 2^53, so exact) and z c mod m is computed as
+ *		z = z1 2^26 + z0,	z1 c' + z0 c,	c' = c 2^26 mod m
+ * with z1 the nearest integer to z 2^-26, and z0 in [-2^25, 2^25]. Both products
+ * (below 2^79) are split exactly into hi + lo by an fma, and their quotients by m
+ * are the nearest integers to z1 c'/m and z0 c/m, rounded by adding 1.5 2^52. A
+ * quotient can be off by one only when the fraction is close to 1/2, so each
+ * remainder is exact and within m/2 + m 2^-23 of 0, their sum within m + m 2^-22,
+ * and three corrections selected by the sign bit (no comparisons) bring it to
+ * [0, m). The result is the same integer as MulModStep gives. There are no integer
+ * operations and no roundings other than the additions of 1.5 2^52, so on CPUs
+ * with two FMA ports this kernel is faster than the AVX2 one, which emulates the
+ * 64 bit products with 32 bit ones.
+ */
+#define BCN_FMA __attribute__((target("avx2,fma")))
+
+struct fma_multiplier
+{
+	__m256d	c, c1, cm, c1m;		/* c, c' = c 2^26 mod m, and c/m, c'/m */
+};
+
+BCN_FMA inline fma_multiplier make_fma_multiplier(const multiplier& a)
+{
+	fma_multiplier	f;
+	uint64_t		c1 = (uint64_t)(((uint128_t)a.c << 26) % BCN_m);
+
+	f.c   = _mm256_set1_pd((double)a.c);
+	f.c1  = _mm256_set1_pd((double)c1);
+	f.cm  = _mm256_set1_pd((double)a.c / (double)BCN_m);
+	f.c1m = _mm256_set1_pd((double)c1 / (double)BCN_m);
+	return f;
+}
+
+/* t + m if t < 0 (by the sign bit, no comparison) */
+BCN_FMA inline __m256d add_if_negative_fma(__m256d t, __m256d m)
+{
+	return _mm256_blendv_pd(t, _mm256_add_pd(t, m), t);
+}
+
+BCN_FMA inline __m256d mulmod_fma(__m256d z, const fma_multiplier& a, __m256d m)
+{
+	const __m256d	two26 = _mm256_set1_pd(67108864.0), inv26 = _mm256_set1_pd(1.0 / 67108864.0);
+	const __m256d	round = _mm256_set1_pd(6755399441055744.0);		/* 1.5 2^52 */
+	__m256d			z1, z0, h1, l1, h0, l0, q1, q0, t;
+
+	z1 = _mm256_sub_pd(_mm256_fmadd_pd(z, inv26, round), round);
+	z0 = _mm256_fnmadd_pd(z1, two26, z);
+
+	h1 = _mm256_mul_pd(z1, a.c1);
+	l1 = _mm256_fmsub_pd(z1, a.c1, h1);
+	h0 = _mm256_mul_pd(z0, a.c);
+	l0 = _mm256_fmsub_pd(z0, a.c, h0);
+
+	q1 = _mm256_sub_pd(_mm256_fmadd_pd(z1, a.c1m, round), round);
+	q0 = _mm256_sub_pd(_mm256_fmadd_pd(z0, a.cm, round), round);
+
+	t = _mm256_add_pd(_mm256_add_pd(_mm256_fnmadd_pd(q1, m, h1), l1),
+					  _mm256_add_pd(_mm256_fnmadd_pd(q0, m, h0), l0));
+
+	t = add_if_negative_fma(t, m);
+	t = add_if_negative_fma(t, m);
+	__m256d u = _mm256_sub_pd(t, m);
+	return _mm256_blendv_pd(u, t, u);
+}
+
+/* exact conversion of the integers z < 2^53 back to uint64_t */
+BCN_FMA inline __m256i to_uint64_fma(__m256d z)
+{
+	const __m256d	magic = _mm256_set1_pd(4503599627370496.0);		/* 2^52 */
+	const __m256i	mask32 = _mm256_set1_epi64x(0xFFFFFFFFLL);
+	__m256d			hi = _mm256_floor_pd(_mm256_mul_pd(z, _mm256_set1_pd(1.0 / 4294967296.0)));
+	__m256d			lo = _mm256_fnmadd_pd(hi, _mm256_set1_pd(4294967296.0), z);
+
+	__m256i h = _mm256_and_si256(_mm256_castpd_si256(_mm256_add_pd(hi, magic)), mask32);
+	__m256i l = _mm256_and_si256(_mm256_castpd_si256(_mm256_add_pd(lo, magic)), mask32);
+	return _mm256_or_si256(_mm256_slli_epi64(h, 32), l);
+}
+
+BCN_FMA inline void store_fma(double* out, __m256d z)
+{
+	_mm256_storeu_pd(out, _mm256_mul_pd(z, _mm256_set1_pd(BCN_minv)));
+}
+
+BCN_FMA inline void store_fma(uint64_t* out, __m256d z)
+{
+	_mm256_storeu_si256((__m256i*)out, to_uint64_fma(z));
+}
+
+BCN_FMA inline void store_fma(float* out, __m256d z)
+{
+	__m128 f = _mm256_cvtpd_ps(_mm256_mul_pd(z, _mm256_set1_pd(BCN_minv)));
+	_mm_storeu_ps(out, _mm_min_ps(f, _mm_set1_ps(BCN_float_max)));
+}
+
+BCN_FMA inline void store_fma(uint32_t* out, __m256d z)
+{
+	__m256d x = _mm256_mul_pd(_mm256_mul_pd(z, _mm256_set1_pd(BCN_minv)), _mm256_set1_pd(BCN_2_32));
+	_mm_storeu_si128((__m128i*)out, to_uint32_avx2(_mm256_floor_pd(x)));
+}
+
+BCN_FMA inline void store_fma(q32* out, __m256d z)
+{
+	__m256d x = _mm256_mul_pd(_mm256_mul_pd(z, _mm256_set1_pd(BCN_minv)), _mm256_set1_pd(BCN_2_32));
+	x = _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(1.0)), _mm256_set1_pd(BCN_q32_max));
+	_mm_storeu_si128((__m128i*)out, to_uint32_avx2(x));
+}
+
+template <class T>
+BCN_FMA inline void kernel_fma(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride)
+{
+	const __m256i			mask32 = _mm256_set1_epi64x(0xFFFFFFFFLL);
+	const __m256d			m = _mm256_set1_pd((double)BCN_m);
+	const fma_multiplier	f = make_fma_multiplier(a);
+	__m256d					s[BCN_LANES / 4];
+	int						j;
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+		s[j] = to_exact_double_avx2(_mm256_loadu_si256((const __m256i*)(z + 4 * j)), mask32);
+
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES / 4; j++)
+		{
+			store_fma(out + 4 * j, s[j]);
+			s[j] = mulmod_fma(s[j], f, m);
+		}
+	}
+
+	for (j = 0; j < BCN_LANES / 4; j++)
+		_mm256_storeu_si256((__m256i*)(z + 4 * j), to_uint64_fma(s[j]));
+}
+
+/*
+ * AVX-512 IFMA: the quotient q = floor(z c52 / 2^52) comes from one vpmadd52huq
+ * (z < 2^53, so its bit 52 is added separately as c52), q is at most 2 below
+ * floor(z c / m), and z c - q m < 3m is reduced with two masked subtractions.
+ */
+#define BCN_AVX512 __attribute__((target("avx512f,avx512dq,avx512ifma")))
+
+BCN_AVX512 inline __m512i mulmod_avx512ifma(__m512i z, __m512i c, __m512i c52, __m512i m, __m512i bit52)
+{
+	__m512i q, r;
+
+	q = _mm512_maskz_mov_epi64(_mm512_test_epi64_mask(z, bit52), c52);
+	q = _mm512_madd52hi_epu64(q, z, c52);
+	r = _mm512_sub_epi64(_mm512_mullo_epi64(z, c), _mm512_mullo_epi64(q, m));
+	r = _mm512_mask_sub_epi64(r, _mm512_cmpge_epu64_mask(r, m), r, m);
+	return _mm512_mask_sub_epi64(r, _mm512_cmpge_epu64_mask(r, m), r, m);
+}
+
+BCN_AVX512 inline __m512d to_double_avx512(__m512i z)
+{
+	return _mm512_mul_pd(_mm512_cvtepu64_pd(z), _mm512_set1_pd(BCN_minv));
+}
+
+BCN_AVX512 inline void store_avx512(double* out, __m512i z)
+{
+	_mm512_storeu_pd(out, to_double_avx512(z));
+}
+
+BCN_AVX512 inline void store_avx512(uint64_t* out, __m512i z)
+{
+	_mm512_storeu_si512(out, z);
+}
+
+/* the zero masking forms avoid a false -Wmaybe-uninitialized of gcc 12 in the plain intrinsics */
+static const __mmask8 BCN_ALL8 = 0xFF;
+
+BCN_AVX512 inline void store_avx512(float* out, __m512i z)
+{
+	__m256 f = _mm512_maskz_cvtpd_ps(BCN_ALL8, to_double_avx512(z));
+	_mm256_storeu_ps(out, _mm256_min_ps(f, _mm256_set1_ps(BCN_float_max)));
+}
+
+BCN_AVX512 inline void store_avx512(uint32_t* out, __m512i z)
+{
+	__m512d x = _mm512_mul_pd(to_double_avx512(z), _mm512_set1_pd(BCN_2_32));
+	_mm256_storeu_si256((__m256i*)out, _mm512_maskz_cvttpd_epu32(BCN_ALL8, x));
+}
+
+BCN_AVX512 inline void store_avx512(q32* out, __m512i z)
+{
+	__m512d x = _mm512_mul_pd(to_double_avx512(z), _mm512_set1_pd(BCN_2_32));
+	x = _mm512_maskz_roundscale_pd(BCN_ALL8, x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm512_maskz_max_pd(BCN_ALL8, x, _mm512_set1_pd(1.0));
+	x = _mm512_maskz_min_pd(BCN_ALL8, x, _mm512_set1_pd(BCN_q32_max));
+	_mm256_storeu_si256((__m256i*)out, _mm512_maskz_cvttpd_epu32(BCN_ALL8, x));
+}
+
+template <class T>
+BCN_AVX512 inline void kernel_avx512ifma(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride)
+{
+	const __m512i	c   = _mm512_set1_epi64(a.c);
+	const __m512i	c52 = _mm512_set1_epi64(a.c52);
+	const __m512i	m   = _mm512_set1_epi64(BCN_m);
+	const __m512i	bit52 = _mm512_set1_epi64(1LL << 52);
+	__m512i			s[BCN_LANES / 8];
+	int				j;
+
+	for (j = 0; j < BCN_LANES / 8; j++)
+		s[j] = _mm512_loadu_si512(z + 8 * j);
+
+	for (size_t k = 0; k < rows; k++, out += stride)
+	{
+		for (j = 0; j < BCN_LANES / 8; j++)
+		{
+			store_avx512(out + 8 * j, s[j]);
+			s[j] = mulmod_avx512ifma(s[j], c, c52, m, bit52);
+		}
+	}
+
+	for (j = 0; j < BCN_LANES / 8; j++)
+		_mm512_storeu_si512(z + 8 * j, s[j]);
+}
+
+#endif // x86-64
+
+
+/* ============================== dispatch ============================== */
+
+enum simd_isa { ISA_SCALAR = 0, ISA_AVX2 = 1, ISA_FMA = 2, ISA_AVX512IFMA = 3 };
+
+inline const char* isa_name(simd_isa isa)
+{
+	static const char* names[] = { "scalar", "avx2", "fma", "avx512ifma" };
+	return names[isa];
+}
+
+/*
+ * detect_isa
+ * The widest instruction set supported by this CPU (CPUID),
+ * possibly lowered by the environment variable BCNRAND_ISA
+ */
+inline simd_isa detect_isa()
+{
+	simd_isa isa = ISA_SCALAR;
+#if defined(BCN_HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		isa = ISA_AVX2;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		isa = ISA_FMA;
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512ifma"))
+		isa = ISA_AVX512IFMA;
+#endif
+	const char* env = getenv("BCNRAND_ISA");
+	if (env)
+	{
+		for (int i = ISA_SCALAR; i < isa; i++)
+			if (strcmp(env, isa_name((simd_isa)i)) == 0)
+				isa = (simd_isa)i;
+	}
+	return isa;
+}
+
+/*
+ * cpu_isa
+ * The widest instruction set of the kernels, detected once (the lanes kernel of generate is
+ * chosen among those up to it by calibrate_generate)
+ */
+inline simd_isa cpu_isa()
+{
+	static const simd_isa isa = detect_isa();
+	return isa;
+}
+
+template <class T>
+inline lanes_kernel_t<T> get_lanes_kernel(simd_isa isa)
+{
+#if defined(BCN_HAVE_X86_KERNELS)
+	if (isa == ISA_AVX512IFMA)
+		return kernel_avx512ifma<T>;
+	if (isa == ISA_FMA)
+		return kernel_fma<T>;
+	if (isa == ISA_AVX2)
+		return kernel_avx2<T>;
+#endif
+	return kernel_scalar<T>;
+}
+
+inline lanes_kernel get_lanes_kernel(simd_isa isa)
+{
+	return get_lanes_kernel<double>(isa);
+}
+
+/*
+ * generate_engine
+ * The default engine of bcn::generate: the lanes kernel of isa, or generate_multistep
+ */
+struct generate_engine
+{
+	simd_isa	isa;
+	bool		multistep;
+};
+
+inline const generate_engine& default_engine();
+
+/*
+ * lanes_generate
+ * Runs the fastest kernel for this CPU (default_engine), see the kernel signature above
+ */
+template <class T>
+inline void lanes_generate(uint64_t* z, T* out, size_t rows, const multiplier& a, size_t stride = BCN_LANES)
+{
+	static const lanes_kernel_t<T> kernel = get_lanes_kernel<T>(default_engine().isa);
+	kernel(z, out, rows, a, stride);
+}
+
+/*
+ * progression
+ * Writes out[i] = z c^i mod 3^33 (converted to T), i = 0..n-1, and returns z c^(n-1).
+ * Lane j of the kernel computes the elements j, j + BCN_LANES, j + 2 BCN_LANES, ...
+ * Parameters:
+ *	z:		input, the first element, in [1, 3^33)
+ *	p:		input, the multiplier c, make_leapfrog(c)
+ *	kernel:	input, one of the kernels above, 0 for the best one for this CPU
+ */
+template <class T>
+inline uint64_t progression(uint64_t z, const leapfrog& p, T* out, size_t n, lanes_kernel_t<T> kernel = 0)
+{
+	uint64_t	s[BCN_LANES];
+	size_t		rows, i;
+	int			j;
+
+	if (n == 0)
+		return z;
+	if (n < 2 * BCN_LANES)
+	{
+		for (i = 0; i + 1 < n; i++, z = MulModStep(z, p.one))
+			store_state(out + i, z);
+		store_state(out + i, z);
+		return z;
+	}
+
+	for (j = 0; j < BCN_LANES; j++, z = MulModStep(z, p.one))
+		s[j] = z;
+
+	// keep at least one row for the tail, the last element is read from it
+	rows = (n - 1) / BCN_LANES;
+	if (kernel)
+		kernel(s, out, rows, p.leap, BCN_LANES);
+	else
+		lanes_generate(s, out, rows, p.leap);
+
+	out += rows * BCN_LANES;
+	n   -= rows * BCN_LANES;
+	for (i = 0; i < n; i++)
+		store_state(out + i, s[i]);
+	return s[n - 1];
+}
+
+/*
+ * multistep
+ * The multipliers 2^(53 j) mod 3^33, j = 1..BCN_MULTISTEP, of the multistep engine
+ */
+static const int BCN_MULTISTEP = 8;
+
+struct multistep
+{
+	multiplier	a[BCN_MULTISTEP];
+};
+
+inline multistep make_multistep()
+{
+	multistep	p;
+	uint64_t	c = 1;
+	int			j;
+
+	for (j = 0; j < BCN_MULTISTEP; j++)
+	{
+		c = barrett_step_opt(c);
+		p.a[j] = make_multiplier(c);
+	}
+	return p;
+}
+
+/*
+ * Step policies of run_stream (bcnrand_kernel.h), the host counterparts of those of bcnrand.h
+ *	bcn_step:		the states of bcnrandom_inline, one barrett step each
+ *	multistep_step:	the same numbers, U at a time by independent multiplications with 2^(53 j)
+ * store writes a state in the format of the kernels (store_state).
+ */
+struct bcn_step
+{
+	typedef uint64_t result_type;
+
+	uint64_t	z;
+
+	explicit bcn_step(uint64_t seed) : z(seed) {}
+
+	uint64_t next() { return z = barrett_step_opt(z); }
+
+	template <int U>
+	void next_block(uint64_t* r)
+	{
+		for (int j = 0; j < U; j++)
+			r[j] = next();
+	}
+
+	double variate(uint64_t r) const { return BCN_minv * r; }
+
+	template <class T>
+	void store(T* p, uint64_t r) const { store_state(p, r); }
+};
+
+inline const multistep& multistep_table()
+{
+	static const multistep p = make_multistep();
+	return p;
+}
+
+struct multistep_step : bcn_step
+{
+	const multistep&	p;
+
+	explicit multistep_step(uint64_t seed) : bcn_step(seed), p(multistep_table()) {}
+
+	/* blocks of BCN_MULTISTEP from the same state, for any U */
+	template <int U>
+	void next_block(uint64_t* r)
+	{
+		BCN_UNROLL
+		for (int j = 0; j < U; j++)
+		{
+			r[j] = MulModStep(z, p.a[j % BCN_MULTISTEP]);
+			if (j % BCN_MULTISTEP == BCN_MULTISTEP - 1 || j == U - 1)
+				z = r[j];
+		}
+	}
+};
+
+/*
+ * generate_multistep
+ * Scalar engine with the same result as generate. Each barrett_step_opt depends on the previous
+ * one, so n calls of bcnrandom_inline are a chain of n multiplication latencies; here the next
+ * BCN_MULTISTEP elements are computed from the current state by independent multiplications
+ * with 2^(53 j), and the state is advanced by the last of them. It is used by generate where
+ * it is measured faster than the lanes kernels (calibrate_generate), and is the host counterpart
+ * of Kernel_Opt_Multistep (the same run_stream with the same step policy).
+ */
+template <class T>
+inline void generate_multistep(uint64_t& state, T* out, size_t n)
+{
+	multistep_step		step(state);
+	strided_output<T>	o = make_strided_output(out, 1);
+
+	run_stream<BCN_MULTISTEP>(step, o, n);
+	state = step.z;
+}
+
+static const size_t	BCN_CALIBRATE_N = 4096;		/* numbers per timing of calibrate_generate */
+static const int	BCN_CALIBRATE_RUNS = 5;		/* timings per engine, the best one is kept */
+
+/*
+ * calibrate_generate
+ * Times generate with the lanes kernel of every instruction set up to cpu_isa(), and
+ * generate_multistep, on BCN_CALIBRATE_N doubles (the best of BCN_CALIBRATE_RUNS runs, well
+ * below a millisecond in all), and returns the fastest engine. With BCNRAND_ISA set, the kernel
+ * of cpu_isa() is returned without a measurement.
+ */
+inline generate_engine calibrate_generate()
+{
+	static const leapfrog	step = make_leapfrog(pow2_53(1));
+	generate_engine			e = { cpu_isa(), false }, c;
+	double					best = HUGE_VAL, t;
+	double*					x;
+	uint64_t				z = BarrettInitBit(1);
+	int						i, r;
+
+	if (getenv("BCNRAND_ISA"))
+		return e;
+
+	x = (double*)malloc(BCN_CALIBRATE_N * sizeof(double));
+	// i = -1 is generate_multistep
+	for (i = -1; i <= (int)cpu_isa(); i++)
+	{
+		c.isa = i < 0 ? ISA_SCALAR : (simd_isa)i;
+		c.multistep = i < 0;
+
+		lanes_kernel_t<double> kernel = get_lanes_kernel<double>(c.isa);
+
+		// the first run is not timed (page faults, cold caches)
+		for (r = 0; r <= BCN_CALIBRATE_RUNS; r++)
+		{
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+			if (c.multistep)
+				generate_multistep(z, x, BCN_CALIBRATE_N);
+			else
+				z = progression(barrett_step_opt(z), step, x, BCN_CALIBRATE_N, kernel);
+			t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			if (r > 0 && t < best)
+			{
+				best = t;
+				e = c;
+			}
+		}
+	}
+	free(x);
+	return e;
+}
+
+/* the engine of generate, calibrated once */
+inline const generate_engine& default_engine()
+{
+	static const generate_engine e = calibrate_generate();
+	return e;
+}
+
+/*
+ * generate
+ * Writes the next n random variates of the sequence to out and advances state by n steps,
+ * the result is the same as out[i] = bcnrandom_inline(&state), i = 0..n-1.
+ * kernel: one of the kernels above, 0 for the fastest engine for this CPU (default_engine)
+ */
+template <class T>
+inline void generate(uint64_t& state, T* out, size_t n, lanes_kernel_t<T> kernel = 0)
+{
+	static const leapfrog step = make_leapfrog(pow2_53(1));
+
+	BCN_STAT_ADD(variates_bcn, n);
+
+	if (!kernel && default_engine().multistep)
+		generate_multistep(state, out, n);
+	else if (n)
+		state = progression(barrett_step_opt(state), step, out, n, kernel);
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_SIMD_H
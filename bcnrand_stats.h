@@ -0,0 +1,258 @@
+/* ************************************************************************** */
+/* * bcnrand_stats.h                                                        * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*	Description:
+	Optional instrumentation of the host version. Compiled with -DBCN_STATS,
+	the host functions count
+		the variates produced by each engine (bcn, combined, combined53), in
+			generate, generate_combined, fill_leapfrog and the engines of
+			bcnrand_engine.h
+		the calls of BarrettInitBit and LCGInitBit and their time
+		the calls of fill, fill_combined and fill_leapfrog, their bytes and
+			time (the bandwidth)
+		the refills of buffered_generator and their time (the stalls of the
+			draws)
+	Without BCN_STATS the macros BCN_STAT_ADD and BCN_STAT_TIMER are empty, and
+	snapshot_stats() returns zeros.
+
+	The counters above are per thread and per engine kind. Per stream, every
+	bcn::engine, bcn::combined_engine and bcn::buffered_generator also counts
+	the variates drawn from it since it was seeded, returned by its member
+	variates() (BCN_STAT_STREAM; without BCN_STATS the member does not exist
+	and variates() returns 0, so the objects keep their size).
+
+	Every thread has its own counters (thread_local, registered once), which
+	only it writes, without atomic read-modify-write: the counters are atomics
+	written with relaxed loads and stores, so that snapshot_stats() can read
+	them from another thread. The times are in ticks of the TSC, converted to
+	nanoseconds in the snapshot. The counters of a thread are kept after it
+	exits.
+
+	Usage:
+			g++ -O3 -mbmi2 -std=c++14 -DBCN_STATS ...
+			bcn::stats_snapshot s = bcn::snapshot_stats();
+			printf("%.2f GB/s\n", s.fill_gb_per_s());
+			bcn::write_stats_json(stdout, s);
+			uint64_t n = e.variates();			// bcn::engine e
+
+	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+**************************************************************************************************************/
+
+#ifndef BCNRAND_STATS_H
+#define BCNRAND_STATS_H
+
+#include <cstdint>
+#include <cstdio>
+
+#ifdef BCN_STATS
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <x86intrin.h>
+#endif
+
+namespace bcn {
+
+/*
+ * stats_snapshot
+ * The sums of the counters of all threads (times in nanoseconds)
+ */
+struct stats_snapshot
+{
+	uint64_t	threads;					/* threads with counters */
+	uint64_t	variates_bcn;				/* variates produced */
+	uint64_t	variates_combined;
+	uint64_t	variates_combined53;
+	uint64_t	barrett_seeds, barrett_ns;	/* BarrettInitBit */
+	uint64_t	lcg_seeds, lcg_ns;			/* LCGInitBit */
+	uint64_t	fills, fill_bytes, fill_ns;	/* fill, fill_combined, fill_leapfrog */
+	uint64_t	refills, refill_ns;			/* buffered_generator */
+
+	double fill_gb_per_s() const	{ return fill_ns ? (double)fill_bytes / fill_ns : 0; }
+	double barrett_ns_per_seed() const	{ return barrett_seeds ? (double)barrett_ns / barrett_seeds : 0; }
+	double lcg_ns_per_seed() const		{ return lcg_seeds ? (double)lcg_ns / lcg_seeds : 0; }
+	double ns_per_refill() const		{ return refills ? (double)refill_ns / refills : 0; }
+};
+
+#ifdef BCN_STATS
+
+typedef std::atomic<uint64_t> stat_counter;
+
+/*
+ * thread_stats
+ * The counters of a thread, times in TSC ticks
+ */
+struct alignas(64) thread_stats
+{
+	stat_counter	variates_bcn, variates_combined, variates_combined53;
+	stat_counter	barrett_seeds, barrett_ticks;
+	stat_counter	lcg_seeds, lcg_ticks;
+	stat_counter	fills, fill_bytes, fill_ticks;
+	stat_counter	refills, refill_ticks;
+
+	thread_stats()
+		: variates_bcn(0), variates_combined(0), variates_combined53(0), barrett_seeds(0), barrett_ticks(0),
+		  lcg_seeds(0), lcg_ticks(0), fills(0), fill_bytes(0), fill_ticks(0), refills(0), refill_ticks(0) {}
+};
+
+/* only the owner thread adds, the snapshot reads */
+inline void stat_add(stat_counter& c, uint64_t n)
+{
+	c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/*
+ * stats_registry
+ * The counters of all threads, and the time of its creation for the conversion of ticks
+ */
+class stats_registry
+{
+public:
+	stats_registry() : m_tsc0(__rdtsc()), m_t0(std::chrono::steady_clock::now()) {}
+
+	thread_stats* add()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// cache aligned, and never freed (the thread may still run at exit)
+		m_threads.push_back(new (aligned_alloc(alignof(thread_stats), sizeof(thread_stats))) thread_stats);
+		return m_threads.back();
+	}
+
+	stats_snapshot snapshot()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stats_snapshot	s = stats_snapshot();
+		double			ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_t0).count();
+		uint64_t		ticks = __rdtsc() - m_tsc0;
+		double			ns_per_tick = ticks ? ns / ticks : 0;
+		uint64_t		barrett = 0, lcg = 0, fill = 0, refill = 0;
+
+		for (size_t i = 0; i < m_threads.size(); i++)
+		{
+			const thread_stats& t = *m_threads[i];
+
+			s.variates_bcn        += t.variates_bcn.load(std::memory_order_relaxed);
+			s.variates_combined   += t.variates_combined.load(std::memory_order_relaxed);
+			s.variates_combined53 += t.variates_combined53.load(std::memory_order_relaxed);
+			s.barrett_seeds += t.barrett_seeds.load(std::memory_order_relaxed);
+			s.lcg_seeds     += t.lcg_seeds.load(std::memory_order_relaxed);
+			s.fills         += t.fills.load(std::memory_order_relaxed);
+			s.fill_bytes    += t.fill_bytes.load(std::memory_order_relaxed);
+			s.refills       += t.refills.load(std::memory_order_relaxed);
+			barrett += t.barrett_ticks.load(std::memory_order_relaxed);
+			lcg     += t.lcg_ticks.load(std::memory_order_relaxed);
+			fill    += t.fill_ticks.load(std::memory_order_relaxed);
+			refill  += t.refill_ticks.load(std::memory_order_relaxed);
+		}
+		s.threads    = m_threads.size();
+		s.barrett_ns = (uint64_t)(barrett * ns_per_tick);
+		s.lcg_ns     = (uint64_t)(lcg * ns_per_tick);
+		s.fill_ns    = (uint64_t)(fill * ns_per_tick);
+		s.refill_ns  = (uint64_t)(refill * ns_per_tick);
+		return s;
+	}
+
+private:
+	std::mutex								m_mutex;
+	std::vector<thread_stats*>				m_threads;
+	uint64_t								m_tsc0;
+	std::chrono::steady_clock::time_point	m_t0;
+};
+
+inline stats_registry& default_stats_registry()
+{
+	static stats_registry r;
+	return r;
+}
+
+/* the counters of the calling thread */
+inline thread_stats& local_stats()
+{
+	static thread_local thread_stats* s = default_stats_registry().add();
+	return *s;
+}
+
+/*
+ * stat_timer
+ * Adds one call and the ticks of its lifetime to two counters of the thread
+ */
+class stat_timer
+{
+public:
+	stat_timer(stat_counter& calls, stat_counter& ticks) : m_ticks(ticks), m_start(__rdtsc())
+	{
+		stat_add(calls, 1);
+	}
+
+	~stat_timer() { stat_add(m_ticks, __rdtsc() - m_start); }
+
+private:
+	stat_counter&	m_ticks;
+	uint64_t		m_start;
+};
+
+inline stats_snapshot snapshot_stats()
+{
+	return default_stats_registry().snapshot();
+}
+
+#define BCN_STAT_CAT2(a, b)			a ## b
+#define BCN_STAT_CAT(a, b)			BCN_STAT_CAT2(a, b)
+#define BCN_STAT_ADD(field, n)		bcn::stat_add(bcn::local_stats().field, (uint64_t)(n))
+#define BCN_STAT_TIMER(calls, ticks)	bcn::stat_timer BCN_STAT_CAT(bcn_stat_timer_, __LINE__)(bcn::local_stats().calls, bcn::local_stats().ticks)
+
+/* the count of a stream, a uint64_t member of the engine that only exists with BCN_STATS */
+#define BCN_STAT_STREAM(counter, n)	((counter) += (uint64_t)(n))
+#define BCN_STAT_STREAM_COUNT(counter)	(counter)
+
+#else
+
+inline stats_snapshot snapshot_stats()
+{
+	return stats_snapshot();
+}
+
+#define BCN_STAT_ADD(field, n)		((void)0)
+#define BCN_STAT_TIMER(calls, ticks)	((void)0)
+#define BCN_STAT_STREAM(counter, n)	((void)0)
+#define BCN_STAT_STREAM_COUNT(counter)	((uint64_t)0)
+
+#endif // BCN_STATS
+
+/*
+ * write_stats_json
+ * Writes the snapshot as a JSON object (the counters, and the derived rates)
+ */
+inline void write_stats_json(FILE* f, const stats_snapshot& s)
+{
+	fprintf(f, "{\n  \"enabled\": %s, \"threads\": %llu,\n",
+#ifdef BCN_STATS
+			"true",
+#else
+			"false",
+#endif
+			(unsigned long long)s.threads);
+	fprintf(f, "  \"variates\": { \"bcn\": %llu, \"combined\": %llu, \"combined53\": %llu },\n",
+			(unsigned long long)s.variates_bcn, (unsigned long long)s.variates_combined,
+			(unsigned long long)s.variates_combined53);
+	fprintf(f, "  \"seeding\": { \"barrett_calls\": %llu, \"barrett_ns\": %llu, \"barrett_ns_per_call\": %.1f, "
+			"\"lcg_calls\": %llu, \"lcg_ns\": %llu, \"lcg_ns_per_call\": %.1f },\n",
+			(unsigned long long)s.barrett_seeds, (unsigned long long)s.barrett_ns, s.barrett_ns_per_seed(),
+			(unsigned long long)s.lcg_seeds, (unsigned long long)s.lcg_ns, s.lcg_ns_per_seed());
+	fprintf(f, "  \"fill\": { \"calls\": %llu, \"bytes\": %llu, \"ns\": %llu, \"gb_per_s\": %.3f },\n",
+			(unsigned long long)s.fills, (unsigned long long)s.fill_bytes, (unsigned long long)s.fill_ns,
+			s.fill_gb_per_s());
+	fprintf(f, "  \"buffer\": { \"refills\": %llu, \"stall_ns\": %llu, \"ns_per_refill\": %.1f }\n}\n",
+			(unsigned long long)s.refills, (unsigned long long)s.refill_ns, s.ns_per_refill());
+}
+
+} // namespace bcn
+
+#endif // BCNRAND_STATS_H
@@ -0,0 +1,333 @@
+/* ************************************************************************** */
+/* * bcnrand_stream.cpp                                                     * */
+/* * Copyright (C) 2012 Deakin University                                   * */
+/* * Authors: Gleb Beliakov, Tim Wilkin, Michael Johnstone                  * */
+/* * Created: 17/10/26     Last Modified: 17/10/26                          * */
+/* ************************************************************************** */
+/*
+ * Writes the random variates of the host version of bcnrand to stdout or to a file,
+ * in binary, for other programs (e.g. PractRand: ./bcnrand_stream -f u32 | RNG_test stdin32)
+ *
+ * Call from the command line:  ./bcnrand_stream -f double -n 268435456 -p 112 -o x.bin
+ *	-e engine:		bcn (default), combined or combined53
+ *	-f format:		double (default), float, u32 (floor(x 2^32)), or raw (the uint64_t states
+ *					z of bcn, the integers rnd of randCombined or randCombined53)
+ *	-n count:		number of variates, 0 (default) for an endless stream
+ *	-p position:	starting position of the sequence (default 112)
+ *	-o file:		output file (default stdout)
+ *	-m:				write the file through mmap (needs -o and -n)
+ *	-b bytes:		size of a batch (default 1 MB)
+ *
+ * The variates are the same as those of bcn::fill (bcnrandom_inline), or of randCombined
+ * (randCombined53), from the given position. The batches are generated by all the threads of the pool
+ * (BCNRAND_THREADS) while a writer thread outputs the previous ones (BCN_STREAM_BUFFERS
+ * buffers in a ring). A pipe is written with vmsplice, without a copy, when its size
+ * can be set to the size of the batch; a file with -m is generated in place.
+ *
+ *	Copyright Gleb Beliakov, Tim Wilkin and Michael Johnstone, 2013
+ */
+
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "bcnrand_fill.h"
+
+using namespace bcn;
+
+static const int	BCN_STREAM_BUFFERS = 3;			/* batches in the ring */
+static const size_t	BCN_MMAP_WINDOW = 1 << 28;		/* bytes of the file mapped at once */
+
+enum stream_format { FORMAT_DOUBLE, FORMAT_FLOAT, FORMAT_U32, FORMAT_RAW };
+
+static const char*	format_names[] = { "double", "float", "u32", "raw" };
+static const size_t	format_sizes[] = { sizeof(double), sizeof(float), sizeof(uint32_t), sizeof(uint64_t) };
+
+enum stream_engine { ENGINE_BCN, ENGINE_COMBINED, ENGINE_COMBINED53 };
+
+static const char*	engine_names[] = { "bcn", "combined", "combined53" };
+
+
+/* ============================== generation ============================== */
+
+template <class T>
+void generate_batch(stream_engine engine, void* out, uint64_t n, uint64_t position, uint64_t first)
+{
+	if (engine == ENGINE_COMBINED)
+		fill_combined((T*)out, n, position, first);
+	else if (engine == ENGINE_COMBINED53)
+		fill_combined<53>((T*)out, n, position, first);
+	else
+		fill((T*)out, n, position + 53 * first);
+}
+
+/* n variates in the format, from the element first of the sequence starting at position */
+static void generate_batch(stream_format format, stream_engine engine, void* out, uint64_t n, uint64_t position, uint64_t first)
+{
+	switch (format)
+	{
+	case FORMAT_FLOAT:	generate_batch<float>(engine, out, n, position, first); break;
+	case FORMAT_U32:	generate_batch<uint32_t>(engine, out, n, position, first); break;
+	case FORMAT_RAW:	generate_batch<uint64_t>(engine, out, n, position, first); break;
+	default:			generate_batch<double>(engine, out, n, position, first); break;
+	}
+}
+
+
+/* ================================ output ================================ */
+
+/*
+ * stream_writer
+ * Writes the batches filled by the generating thread with its own thread. A buffer is
+ * given back when its bytes are out: after write, or after the next vmsplice (the pipe
+ * holds only one batch, so when vmsplice of the next one returns it has been read).
+ */
+class stream_writer
+{
+public:
+	stream_writer(int fd, size_t batch) : m_fd(fd), m_batch(batch), m_splice(false), m_error(0),
+		m_filled(0), m_written(0), m_released(0), m_done(false)
+	{
+		for (int i = 0; i < BCN_STREAM_BUFFERS; i++)
+			m_buf[i] = (char*)aligned_alloc(4096, batch);
+
+#if defined(F_SETPIPE_SZ)
+		struct stat st;
+
+		if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode))
+			m_splice = fcntl(fd, F_SETPIPE_SZ, (int)batch) == (int)batch;
+#endif
+		m_thread = std::thread(&stream_writer::run, this);
+	}
+
+	~stream_writer()
+	{
+		for (int i = 0; i < BCN_STREAM_BUFFERS; i++)
+			free(m_buf[i]);
+	}
+
+	/* the next buffer to fill, waits until it is free; 0 after an error of the output */
+	char* acquire()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_cond.wait(lock, [this] { return m_filled - m_released < (uint64_t)BCN_STREAM_BUFFERS || m_error; });
+		return m_error ? 0 : m_buf[m_filled % BCN_STREAM_BUFFERS];
+	}
+
+	/* the buffer of acquire has bytes to write */
+	void submit(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_bytes[m_filled % BCN_STREAM_BUFFERS] = bytes;
+		m_filled++;
+		m_cond.notify_all();
+	}
+
+	/* waits for the writer, returns 0 or the error of the output */
+	int finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done = true;
+			m_cond.notify_all();
+		}
+		m_thread.join();
+		return m_error;
+	}
+
+	bool splice() const { return m_splice; }
+
+private:
+	void run()
+	{
+		for (;;)
+		{
+			uint64_t k;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+
+				m_cond.wait(lock, [this] { return m_written < m_filled || m_done; });
+				if (m_written == m_filled)
+					return;
+				k = m_written;
+			}
+
+			int err = output(m_buf[k % BCN_STREAM_BUFFERS], m_bytes[k % BCN_STREAM_BUFFERS]);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				m_written = k + 1;
+				m_released = m_splice ? k : k + 1;
+				m_error = err;
+				m_cond.notify_all();
+				if (err)
+					return;
+			}
+		}
+	}
+
+	int output(const char* p, size_t bytes)
+	{
+		while (bytes)
+		{
+			ssize_t r;
+
+			if (m_splice)
+			{
+				struct iovec iov = { (void*)p, bytes };
+				r = vmsplice(m_fd, &iov, 1, 0);
+			}
+			else
+				r = write(m_fd, p, bytes);
+			if (r < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return errno;
+			}
+			p += r;
+			bytes -= r;
+		}
+		return 0;
+	}
+
+	int							m_fd;
+	size_t						m_batch;
+	bool						m_splice;
+	int							m_error;
+	char*						m_buf[BCN_STREAM_BUFFERS];
+	size_t						m_bytes[BCN_STREAM_BUFFERS];
+	uint64_t					m_filled, m_written, m_released;	/* batches */
+	bool						m_done;
+	std::mutex					m_mutex;
+	std::condition_variable		m_cond;
+	std::thread					m_thread;
+};
+
+/* count variates (0 for no end) through the writer */
+static int stream(int fd, stream_format format, stream_engine engine, uint64_t count, uint64_t position, size_t batch)
+{
+	const size_t	size = format_sizes[format];
+	const uint64_t	per_batch = batch / size;
+	stream_writer	writer(fd, per_batch * size);
+	uint64_t		first;
+
+	for (first = 0; count == 0 || first < count; first += per_batch)
+	{
+		uint64_t	n = count == 0 || count - first > per_batch ? per_batch : count - first;
+		char*		buf = writer.acquire();
+
+		if (!buf)
+			break;
+		generate_batch(format, engine, buf, n, position, first);
+		writer.submit(n * size);
+	}
+	return writer.finish();
+}
+
+/* count variates generated in place in the file, through windows of BCN_MMAP_WINDOW bytes */
+static int stream_mmap(int fd, stream_format format, stream_engine engine, uint64_t count, uint64_t position)
+{
+	const size_t	size = format_sizes[format];
+	const uint64_t	per_window = BCN_MMAP_WINDOW / size;
+
+	if (ftruncate(fd, (off_t)(count * size)) != 0)
+		return errno;
+
+	for (uint64_t first = 0; first < count; first += per_window)
+	{
+		uint64_t	n = count - first > per_window ? per_window : count - first;
+		void*		p = mmap(0, n * size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)(first * size));
+
+		if (p == MAP_FAILED)
+			return errno;
+		generate_batch(format, engine, p, n, position, first);
+		munmap(p, n * size);
+	}
+	return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+	stream_format	format = FORMAT_DOUBLE;
+	stream_engine	engine = ENGINE_BCN;
+	bool			use_mmap = false;
+	uint64_t		count = 0, position = 112;
+	size_t			batch = 1 << 20;
+	const char*		file = 0;
+	int				c, fd = STDOUT_FILENO, err;
+
+	while ((c = getopt(argc, argv, "e:f:n:p:o:mb:")) != -1)
+	{
+		switch (c)
+		{
+		case 'e':
+			for (c = ENGINE_BCN; c <= ENGINE_COMBINED53; c++)
+				if (strcmp(optarg, engine_names[c]) == 0)
+					break;
+			if (c > ENGINE_COMBINED53)
+				goto usage;
+			engine = (stream_engine)c;
+			break;
+		case 'f':
+			for (c = FORMAT_DOUBLE; c <= FORMAT_RAW; c++)
+				if (strcmp(optarg, format_names[c]) == 0)
+					break;
+			if (c > FORMAT_RAW)
+				goto usage;
+			format = (stream_format)c;
+			break;
+		case 'n':	count = strtoull(optarg, 0, 10); break;
+		case 'p':	position = strtoull(optarg, 0, 10); break;
+		case 'o':	file = optarg; break;
+		case 'm':	use_mmap = true; break;
+		case 'b':	batch = strtoull(optarg, 0, 10); break;
+		default:	goto usage;
+		}
+	}
+	if (optind != argc || batch < sizeof(uint64_t) || (use_mmap && (!file || !count)))
+		goto usage;
+
+	if (file && (fd = open(file, O_CREAT | O_TRUNC | (use_mmap ? O_RDWR : O_WRONLY), 0644)) < 0)
+	{
+		fprintf(stderr, "bcnrand_stream: %s: %s\n", file, strerror(errno));
+		return 1;
+	}
+
+	// a closed pipe ends an endless stream with EPIPE
+	signal(SIGPIPE, SIG_IGN);
+
+	if (use_mmap)
+		err = stream_mmap(fd, format, engine, count, position);
+	else
+		err = stream(fd, format, engine, count, position, batch);
+
+	if (file)
+		close(fd);
+	if (err && !(err == EPIPE && count == 0))
+	{
+		fprintf(stderr, "bcnrand_stream: %s\n", strerror(err));
+		return 1;
+	}
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage ./bcnrand_stream [-e bcn|combined|combined53] [-f double|float|u32|raw] [-n count] [-p position] "
+					"[-o file [-m]] [-b batch bytes]\n");
+	return 1;
+}